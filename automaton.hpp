@@ -0,0 +1,350 @@
+#ifndef INT2D_AUTOMATON_HPP
+#define INT2D_AUTOMATON_HPP
+
+// Life-like cellular automata over bit-packed grids.
+//
+// Rows are stored as 64-bit words with one cell per bit (bit 0 is the
+// leftmost cell of the word). Neighbor counts for a whole word are
+// computed at once using bit-sliced adders, so each step costs a few
+// dozen bitwise operations per 64 cells.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+// A birth/survival rule. Bit N of 'birth' is set if dead cells with
+// N live neighbors become alive. Bit N of 'survive' is set if live cells
+// with N live neighbors stay alive.
+struct ca_rule_t
+{
+    std::uint16_t birth;
+    std::uint16_t survive;
+
+    // Parses rules written like "B3/S23". Throws std::invalid_argument.
+    static ca_rule_t from_string(std::string const& str);
+};
+
+constexpr bool operator==(ca_rule_t lhs, ca_rule_t rhs)
+{
+    return lhs.birth == rhs.birth && lhs.survive == rhs.survive;
+}
+
+constexpr bool operator!=(ca_rule_t lhs, ca_rule_t rhs)
+{
+    return !(lhs == rhs);
+}
+
+constexpr ca_rule_t life_rule = { 1 << 3, (1 << 2) | (1 << 3) }; // B3/S23
+constexpr ca_rule_t cave_rule = { 0x1C0, 0x1F8 }; // B678/S345678
+
+inline ca_rule_t ca_rule_t::from_string(std::string const& str)
+{
+    ca_rule_t rule = { 0, 0 };
+    std::uint16_t* counts = nullptr;
+    for(char ch : str)
+    {
+        if(ch == 'B' || ch == 'b')
+            counts = &rule.birth;
+        else if(ch == 'S' || ch == 's')
+            counts = &rule.survive;
+        else if(ch >= '0' && ch <= '8' && counts)
+            *counts |= 1 << (ch - '0');
+        else if(ch != '/')
+            throw std::invalid_argument("ca_rule_t::from_string");
+    }
+    return rule;
+}
+
+// A grid of booleans that steps a Life-like automaton.
+// Work is split into tiles one word wide and 'tile_rows' rows tall.
+// Tiles whose neighborhood didn't change last step are copied instead
+// of being recomputed, so mostly-stable maps step quickly.
+class bit_automaton_t
+{
+public:
+    using word_type = std::uint64_t;
+    static constexpr int2d_t word_bits = 64;
+    static constexpr int2d_t tile_rows = 32;
+
+    bit_automaton_t()
+    : bit_automaton_t(dimen_t{0,0})
+    {}
+
+    // If 'wrap' is true the map is toroidal, otherwise cells outside it
+    // are dead.
+    explicit bit_automaton_t(dimen_t dim, bool wrap = false)
+    : m_dim(dim)
+    , m_words((dim.w + word_bits - 1) / word_bits)
+    , m_tiles{ static_cast<int2d_t>(m_words),
+               (dim.h + tile_rows - 1) / tile_rows }
+    , m_wrap(wrap)
+    , m_cur(m_words * dim.h)
+    , m_next(m_words * dim.h)
+    , m_dirty(area(m_tiles), 1)
+    , m_next_dirty(area(m_tiles))
+    {}
+
+    // Cells of 'grid' that convert to 'true' start alive.
+    template<typename Grid>
+    explicit bit_automaton_t(Grid const& grid, bool wrap = false)
+    : bit_automaton_t(grid.dimen(), wrap)
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        for(coord_t crd : dimen_range(m_dim))
+            if(grid[crd])
+                m_cur[word_index(crd)] |= bit(crd);
+    }
+
+    dimen_t dimen() const { return m_dim; }
+    bool wraps() const { return m_wrap; }
+
+    bool operator[](coord_t crd) const
+    {
+        return m_cur[word_index(crd)] & bit(crd);
+    }
+
+    void set(coord_t crd, bool alive)
+    {
+        assert(in_bounds(crd, m_dim));
+        word_type& word = m_cur[word_index(crd)];
+        word = alive ? (word | bit(crd)) : (word & ~bit(crd));
+        m_dirty[tile_index(crd.x / word_bits, crd.y / tile_rows)] = 1;
+    }
+
+    // The words of row 'y'. Bits past the right edge are always 0.
+    word_type const* row_data(int2d_t y) const
+    {
+        return m_cur.data() + y * m_words;
+    }
+
+    std::size_t words_per_row() const { return m_words; }
+
+    // The number of live cells.
+    std::size_t population() const
+    {
+        std::size_t count = 0;
+        for(word_type word : m_cur)
+            count += __builtin_popcountll(word);
+        return count;
+    }
+
+    // True if the last step changed nothing.
+    bool stable() const
+    {
+        return std::none_of(m_dirty.begin(), m_dirty.end(),
+                            [](std::uint8_t d) { return d; });
+    }
+
+    // Bands passed to 'parallel_bands' are measured in rows of tiles.
+    void step(ca_rule_t rule, parallel_opts_t opts = { 2, 0 })
+    {
+        if(!m_dim)
+            return;
+        parallel_bands(0, m_tiles.h, [&](int2d_t b, int2d_t e)
+        {
+            for(int2d_t ty = b; ty < e; ++ty)
+            for(int2d_t tx = 0; tx < m_tiles.w; ++tx)
+                step_tile(rule, tx, ty);
+        }, opts);
+        m_cur.swap(m_next);
+        m_dirty.swap(m_next_dirty);
+    }
+
+    void step(ca_rule_t rule, unsigned steps, parallel_opts_t opts = { 2, 0 })
+    {
+        for(unsigned i = 0; i < steps && !stable(); ++i)
+            step(rule, opts);
+    }
+
+    // Copies the cells into 'grid', which must have the same dimensions.
+    template<typename Grid>
+    void to_grid(Grid& grid) const
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(grid.dimen() == m_dim);
+        using value_type = typename Grid::value_type;
+        for(coord_t crd : dimen_range(m_dim))
+            grid[crd] = static_cast<value_type>(operator[](crd));
+    }
+private:
+    std::size_t word_index(coord_t crd) const
+    {
+        return crd.y * m_words + crd.x / word_bits;
+    }
+
+    static word_type bit(coord_t crd)
+    {
+        return word_type(1) << (crd.x % word_bits);
+    }
+
+    std::size_t tile_index(int2d_t tx, int2d_t ty) const
+    {
+        return ty * m_tiles.w + tx;
+    }
+
+    // Mask of the bits in word 'i' that are inside the map.
+    word_type valid_mask(std::size_t i) const
+    {
+        int2d_t const rem = m_dim.w % word_bits;
+        if(i + 1 != m_words || rem == 0)
+            return ~word_type(0);
+        return (word_type(1) << rem) - 1;
+    }
+
+    // Returns row 'y' of the current state, or null if it's outside
+    // a non-wrapping map.
+    word_type const* row_or_null(int2d_t y) const
+    {
+        if(y < 0 || y >= m_dim.h)
+        {
+            if(!m_wrap)
+                return nullptr;
+            y = (y + m_dim.h) % m_dim.h;
+        }
+        return m_cur.data() + y * m_words;
+    }
+
+    bool tile_dirty(int2d_t tx, int2d_t ty) const
+    {
+        if(m_wrap)
+        {
+            tx = (tx + m_tiles.w) % m_tiles.w;
+            ty = (ty + m_tiles.h) % m_tiles.h;
+        }
+        else if(!in_bounds(coord_t{ tx, ty }, m_tiles))
+            return false;
+        return m_dirty[tile_index(tx, ty)];
+    }
+
+    // A tile needs recomputing if anything within one tile of it changed.
+    bool tile_active(int2d_t tx, int2d_t ty) const
+    {
+        for(int2d_t y = ty - 1; y <= ty + 1; ++y)
+        for(int2d_t x = tx - 1; x <= tx + 1; ++x)
+            if(tile_dirty(x, y))
+                return true;
+        return false;
+    }
+
+    // Loads word 'i' of 'row' together with the words holding the
+    // west and east neighbors of each of its cells.
+    void load(word_type const* row, std::size_t i,
+              word_type& w, word_type& west, word_type& east) const
+    {
+        if(!row)
+        {
+            w = west = east = 0;
+            return;
+        }
+        w = row[i];
+        std::size_t const last = m_words - 1;
+        word_type const prev = i > 0 ? row[i - 1]
+                             : m_wrap ? row[last] : 0;
+        word_type const next = i < last ? row[i + 1]
+                             : m_wrap ? row[0] : 0;
+        west = (w << 1) | (prev >> (word_bits - 1));
+        east = (w >> 1) | (next << (word_bits - 1));
+
+        int2d_t const rem = m_dim.w % word_bits;
+        if(rem != 0)
+        {
+            // The last word is partial, so wrapped neighbors aren't
+            // where the shifts above expect.
+            int2d_t const last_bit = rem - 1;
+            if(i == 0 && m_wrap)
+                west = (west & ~word_type(1))
+                       | ((row[last] >> last_bit) & 1);
+            if(i == last)
+            {
+                east &= ~(word_type(1) << last_bit);
+                if(m_wrap)
+                    east |= (row[0] & 1) << last_bit;
+            }
+        }
+    }
+
+    void step_tile(ca_rule_t rule, int2d_t tx, int2d_t ty)
+    {
+        int2d_t const y0 = ty * tile_rows;
+        int2d_t const y1 = std::min(y0 + tile_rows, m_dim.h);
+        std::size_t const i = tx;
+
+        if(!tile_active(tx, ty))
+        {
+            for(int2d_t y = y0; y < y1; ++y)
+                m_next[y * m_words + i] = m_cur[y * m_words + i];
+            m_next_dirty[tile_index(tx, ty)] = 0;
+            return;
+        }
+
+        word_type const mask = valid_mask(i);
+        word_type changed = 0;
+        for(int2d_t y = y0; y < y1; ++y)
+        {
+            word_type n, nw, ne, c, w, e, s, sw, se;
+            load(row_or_null(y - 1), i, n, nw, ne);
+            load(row_or_null(y), i, c, w, e);
+            load(row_or_null(y + 1), i, s, sw, se);
+
+            // Bit-sliced sum of the 8 neighbors.
+            // Rows above and below go through full adders,
+            // the middle row through a half adder.
+            word_type const a1 = nw ^ n ^ ne;
+            word_type const a2 = (nw & n) | (ne & (nw ^ n));
+            word_type const b1 = sw ^ s ^ se;
+            word_type const b2 = (sw & s) | (se & (sw ^ s));
+            word_type const m1 = w ^ e;
+            word_type const m2 = w & e;
+
+            word_type const bit0 = a1 ^ b1 ^ m1;
+            word_type const carry = (a1 & b1) | (m1 & (a1 ^ b1));
+            word_type const t = a2 ^ b2 ^ m2;
+            word_type const tc = (a2 & b2) | (m2 & (a2 ^ b2));
+            word_type const bit1 = t ^ carry;
+            word_type const k = t & carry;
+            word_type const bit2 = tc ^ k;
+            word_type const bit3 = tc & k;
+
+            word_type result = 0;
+            for(unsigned count = 0; count <= 8; ++count)
+            {
+                bool const born = rule.birth & (1u << count);
+                bool const lives = rule.survive & (1u << count);
+                if(!born && !lives)
+                    continue;
+                word_type const eq =
+                    (count & 1 ? bit0 : ~bit0)
+                    & (count & 2 ? bit1 : ~bit1)
+                    & (count & 4 ? bit2 : ~bit2)
+                    & (count & 8 ? bit3 : ~bit3);
+                result |= eq & ((born ? ~c : 0) | (lives ? c : 0));
+            }
+            result &= mask;
+            changed |= result ^ c;
+            m_next[y * m_words + i] = result;
+        }
+        m_next_dirty[tile_index(tx, ty)] = changed != 0;
+    }
+
+    dimen_t m_dim;
+    std::size_t m_words;
+    dimen_t m_tiles;
+    bool m_wrap;
+    std::vector<word_type> m_cur;
+    std::vector<word_type> m_next;
+    std::vector<std::uint8_t> m_dirty;
+    std::vector<std::uint8_t> m_next_dirty;
+};
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef INT2D_BOUNDS_HPP
+#define INT2D_BOUNDS_HPP
+
+// Bounding boxes of large arrays of coords and rects.
+//
+// The kernels keep separate minimums and maximums for several lanes so
+// that the compiler can turn them into vector min/max instructions, and
+// the lanes are combined at the end. The parallel versions split the
+// array into blocks with 'parallel_bands'.
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+
+#include "geometry.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+namespace impl
+{
+    // A running bounding box as inclusive corners.
+    struct bounds_acc_t
+    {
+        coord_t lo = { std::numeric_limits<int2d_t>::max(),
+                       std::numeric_limits<int2d_t>::max() };
+        coord_t hi = { std::numeric_limits<int2d_t>::min(),
+                       std::numeric_limits<int2d_t>::min() };
+
+        void merge(bounds_acc_t const& o)
+        {
+            lo.x = std::min(lo.x, o.lo.x);
+            lo.y = std::min(lo.y, o.lo.y);
+            hi.x = std::max(hi.x, o.hi.x);
+            hi.y = std::max(hi.y, o.hi.y);
+        }
+
+        rect_t rect() const
+        {
+            if(lo.x > hi.x)
+                return { { 0, 0 }, { 0, 0 } };
+            return { lo, { hi.x - lo.x + 1, hi.y - lo.y + 1 } };
+        }
+    };
+
+    constexpr std::size_t bounds_lanes = 8;
+    constexpr std::size_t bounds_block = 4096;
+
+    // Calls 'func(acc, i)' for i in [0, n) with 'bounds_lanes' separate
+    // accumulators, then merges them into 'acc'.
+    template<typename Func>
+    void lane_bounds(std::size_t n, bounds_acc_t& acc, Func func)
+    {
+        constexpr std::size_t lanes = bounds_lanes;
+        int2d_t x1[lanes], y1[lanes], x2[lanes], y2[lanes];
+        for(std::size_t j = 0; j < lanes; ++j)
+        {
+            x1[j] = acc.lo.x;
+            y1[j] = acc.lo.y;
+            x2[j] = acc.hi.x;
+            y2[j] = acc.hi.y;
+        }
+        std::size_t i = 0;
+        for(; i + lanes <= n; i += lanes)
+        for(std::size_t j = 0; j < lanes; ++j)
+            func(i + j, x1[j], y1[j], x2[j], y2[j]);
+        for(; i < n; ++i)
+            func(i, x1[0], y1[0], x2[0], y2[0]);
+        for(std::size_t j = 0; j < lanes; ++j)
+        {
+            acc.lo.x = std::min(acc.lo.x, x1[j]);
+            acc.lo.y = std::min(acc.lo.y, y1[j]);
+            acc.hi.x = std::max(acc.hi.x, x2[j]);
+            acc.hi.y = std::max(acc.hi.y, y2[j]);
+        }
+    }
+
+    inline void coord_bounds(coord_t const* crds, std::size_t n,
+                             bounds_acc_t& acc)
+    {
+        lane_bounds(n, acc, [crds](std::size_t i, int2d_t& x1, int2d_t& y1,
+                                   int2d_t& x2, int2d_t& y2)
+        {
+            coord_t const c = crds[i];
+            x1 = c.x < x1 ? c.x : x1;
+            y1 = c.y < y1 ? c.y : y1;
+            x2 = c.x > x2 ? c.x : x2;
+            y2 = c.y > y2 ? c.y : y2;
+        });
+    }
+
+    inline void rect_bounds(rect_t const* rects, std::size_t n,
+                            bounds_acc_t& acc)
+    {
+        lane_bounds(n, acc, [rects](std::size_t i, int2d_t& x1, int2d_t& y1,
+                                    int2d_t& x2, int2d_t& y2)
+        {
+            rect_t const r = rects[i];
+            // Empty rects are selected away rather than branched over.
+            bool const empty = r.d.w <= 0 || r.d.h <= 0;
+            int2d_t const rx1 = empty ? x1 : r.c.x;
+            int2d_t const ry1 = empty ? y1 : r.c.y;
+            int2d_t const rx2 = empty ? x2 : r.c.x + r.d.w - 1;
+            int2d_t const ry2 = empty ? y2 : r.c.y + r.d.h - 1;
+            x1 = rx1 < x1 ? rx1 : x1;
+            y1 = ry1 < y1 ? ry1 : y1;
+            x2 = rx2 > x2 ? rx2 : x2;
+            y2 = ry2 > y2 ? ry2 : y2;
+        });
+    }
+
+    // Runs 'kernel(T const*, std::size_t, bounds_acc_t&)' over blocks of
+    // 'data' in parallel.
+    template<typename T, typename Kernel>
+    rect_t parallel_bounds(T const* data, std::size_t n, Kernel kernel,
+                           parallel_opts_t opts)
+    {
+        bounds_acc_t ret;
+        std::size_t const blocks = (n + bounds_block - 1) / bounds_block;
+        std::mutex mutex;
+        parallel_bands(0, static_cast<int2d_t>(blocks),
+                       [&](int2d_t b, int2d_t e)
+        {
+            std::size_t const first = std::size_t(b) * bounds_block;
+            std::size_t const last = std::min(n, std::size_t(e) * bounds_block);
+            bounds_acc_t acc;
+            kernel(data + first, last - first, acc);
+            std::lock_guard<std::mutex> lock(mutex);
+            ret.merge(acc);
+        }, opts);
+        return ret.rect();
+    }
+} // namespace impl
+
+// The smallest rect containing the 'n' coords at 'crds', or an empty rect
+// if 'n' is 0.
+inline rect_t coord_bounds(coord_t const* crds, std::size_t n)
+{
+    impl::bounds_acc_t acc;
+    impl::coord_bounds(crds, n, acc);
+    return acc.rect();
+}
+
+// As above, split across threads. 'opts.min_band' counts blocks of 4096
+// coords.
+inline rect_t coord_bounds(coord_t const* crds, std::size_t n,
+                           parallel_opts_t opts)
+{
+    return impl::parallel_bounds(
+        crds, n,
+        [](coord_t const* d, std::size_t m, impl::bounds_acc_t& acc)
+        {
+            impl::coord_bounds(d, m, acc);
+        },
+        opts);
+}
+
+// The smallest rect containing the 'n' rects at 'rects', skipping empty
+// ones, or an empty rect if they're all empty.
+inline rect_t rect_bounds(rect_t const* rects, std::size_t n)
+{
+    impl::bounds_acc_t acc;
+    impl::rect_bounds(rects, n, acc);
+    return acc.rect();
+}
+
+// As above, split across threads. 'opts.min_band' counts blocks of 4096
+// rects.
+inline rect_t rect_bounds(rect_t const* rects, std::size_t n,
+                          parallel_opts_t opts)
+{
+    return impl::parallel_bounds(
+        rects, n,
+        [](rect_t const* d, std::size_t m, impl::bounds_acc_t& acc)
+        {
+            impl::rect_bounds(d, m, acc);
+        },
+        opts);
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,563 @@
+#ifndef INT2D_COORD_MAP_HPP
+#define INT2D_COORD_MAP_HPP
+
+// Hashing of coords, and flat hash sets and maps keyed by 'coord_t'.
+//
+// 'coord_set_t' and 'coord_map_t' use open addressing over one array of
+// slots, split into groups of 16. Each slot has a control byte that is
+// either empty, deleted, or 7 bits of the key's hash, so a lookup checks
+// a whole group with one SSE2 compare and only looks at the keys whose
+// bytes match. Probing moves group by group and stops at the first group
+// with an empty slot. Nothing is allocated per element, which suits
+// closed lists of searches and sparse annotations of grids.
+//
+// Inserting or erasing invalidates iterators and pointers to values.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "units.hpp"
+
+namespace i2d {
+
+namespace impl
+{
+    // Murmur3's finalizer. Every bit of 'k' affects every bit of the result.
+    constexpr std::uint64_t mix64(std::uint64_t k)
+    {
+        k ^= k >> 33;
+        k *= 0xFF51AFD7ED558CCDull;
+        k ^= k >> 33;
+        k *= 0xC4CEB9FE1A85EC53ull;
+        k ^= k >> 33;
+        return k;
+    }
+} // namespace impl
+
+// A well mixed 64 bit hash. Coords of up to 32 bits never collide.
+template<typename S>
+constexpr std::uint64_t coord_hash(basic_coord_t<S> crd)
+{
+    return sizeof(S) <= 4
+           ? impl::mix64((std::uint64_t(std::uint32_t(crd.x)) << 32)
+                         | std::uint32_t(crd.y))
+           : impl::mix64(std::uint64_t(crd.x) * 0x9E3779B97F4A7C15ull
+                         ^ impl::mix64(std::uint64_t(crd.y)));
+}
+
+namespace impl
+{
+    using ctrl_t = std::int8_t;
+
+    // Full slots hold 7 bits of hash, so they're never negative.
+    enum : ctrl_t { ctrl_empty = -128, ctrl_deleted = -2 };
+
+    constexpr std::size_t group_width = 16;
+
+    // Bit 'i' of each mask is set when byte 'i' of the group matches.
+    struct group_t
+    {
+#ifdef __SSE2__
+        explicit group_t(ctrl_t const* ctrl)
+        : m_ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const*>(ctrl)))
+        {}
+
+        std::uint32_t match(ctrl_t h2) const
+        {
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+        }
+
+        std::uint32_t match_empty() const { return match(ctrl_empty); }
+
+        std::uint32_t match_free() const
+        {
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(m_ctrl));
+        }
+
+        __m128i m_ctrl;
+#else
+        explicit group_t(ctrl_t const* ctrl)
+        {
+            std::memcpy(m_ctrl, ctrl, group_width);
+        }
+
+        std::uint32_t match(ctrl_t h2) const
+        {
+            std::uint32_t mask = 0;
+            for(std::size_t i = 0; i < group_width; ++i)
+                mask |= std::uint32_t(m_ctrl[i] == h2) << i;
+            return mask;
+        }
+
+        std::uint32_t match_empty() const { return match(ctrl_empty); }
+
+        std::uint32_t match_free() const
+        {
+            std::uint32_t mask = 0;
+            for(std::size_t i = 0; i < group_width; ++i)
+                mask |= std::uint32_t(m_ctrl[i] < 0) << i;
+            return mask;
+        }
+
+        ctrl_t m_ctrl[group_width];
+#endif
+    };
+
+    inline unsigned lowest_bit(std::uint32_t mask)
+    {
+        assert(mask);
+        return static_cast<unsigned>(__builtin_ctz(mask));
+    }
+
+    inline coord_t const& slot_key(coord_t const& crd) { return crd; }
+
+    template<typename T>
+    coord_t const& slot_key(std::pair<coord_t const, T> const& slot)
+    {
+        return slot.first;
+    }
+
+    // The table shared by 'coord_set_t' and 'coord_map_t'.
+    template<typename Slot>
+    class coord_table_t
+    {
+    public:
+        template<typename V>
+        class basic_iterator
+        : public std::iterator<std::forward_iterator_tag, V>
+        {
+            friend class coord_table_t;
+        public:
+            basic_iterator() = default;
+
+            // Allows iterator to const_iterator conversion.
+            template<typename U>
+            basic_iterator(basic_iterator<U> it)
+            : m_ctrl(it.m_ctrl), m_slot(it.m_slot), m_end(it.m_end)
+            {}
+
+            V& operator*() const { return *m_slot; }
+            V* operator->() const { return m_slot; }
+
+            basic_iterator& operator++()
+            {
+                ++m_ctrl;
+                ++m_slot;
+                skip_free();
+                return *this;
+            }
+
+            basic_iterator operator++(int)
+            {
+                basic_iterator ret = *this;
+                ++(*this);
+                return ret;
+            }
+
+            bool operator==(basic_iterator o) const
+                { return m_slot == o.m_slot; }
+            bool operator!=(basic_iterator o) const
+                { return m_slot != o.m_slot; }
+        private:
+            template<typename U>
+            friend class basic_iterator;
+
+            basic_iterator(ctrl_t const* ctrl, V* slot, ctrl_t const* end)
+            : m_ctrl(ctrl), m_slot(slot), m_end(end)
+            {
+                skip_free();
+            }
+
+            void skip_free()
+            {
+                while(m_ctrl != m_end && *m_ctrl < 0)
+                {
+                    ++m_ctrl;
+                    ++m_slot;
+                }
+            }
+
+            ctrl_t const* m_ctrl = nullptr;
+            V* m_slot = nullptr;
+            ctrl_t const* m_end = nullptr;
+        };
+
+        using iterator = basic_iterator<Slot>;
+        using const_iterator = basic_iterator<Slot const>;
+
+        coord_table_t() = default;
+
+        coord_table_t(coord_table_t const& o)
+        {
+            reserve(o.m_size);
+            for(Slot const& slot : o)
+                insert_new(slot_key(slot), slot);
+        }
+
+        coord_table_t(coord_table_t&& o) noexcept { swap(o); }
+
+        coord_table_t& operator=(coord_table_t o) noexcept
+        {
+            swap(o);
+            return *this;
+        }
+
+        ~coord_table_t() { destroy(); }
+
+        void swap(coord_table_t& o) noexcept
+        {
+            using std::swap;
+            swap(m_ctrl, o.m_ctrl);
+            swap(m_slots, o.m_slots);
+            swap(m_capacity, o.m_capacity);
+            swap(m_size, o.m_size);
+            swap(m_growth_left, o.m_growth_left);
+        }
+
+        std::size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        std::size_t capacity() const { return m_capacity; }
+
+        iterator begin() { return { m_ctrl.data(), m_slots, ctrl_end() }; }
+        iterator end() { return { ctrl_end(), m_slots + m_capacity,
+                                  ctrl_end() }; }
+        const_iterator begin() const
+            { return { m_ctrl.data(), m_slots, ctrl_end() }; }
+        const_iterator end() const
+            { return { ctrl_end(), m_slots + m_capacity, ctrl_end() }; }
+
+        void clear()
+        {
+            for(std::size_t i = 0; i < m_capacity; ++i)
+                if(m_ctrl[i] >= 0)
+                    m_slots[i].~Slot();
+            std::fill(m_ctrl.begin(), m_ctrl.end(), ctrl_t(ctrl_empty));
+            m_size = 0;
+            m_growth_left = max_load(m_capacity);
+        }
+
+        // Makes room for 'n' elements without rehashing.
+        void reserve(std::size_t n)
+        {
+            std::size_t cap = group_width;
+            while(max_load(cap) < n)
+                cap *= 2;
+            if(cap > m_capacity)
+                rehash(cap);
+        }
+
+        Slot* find(coord_t crd)
+        {
+            std::size_t const i = find_index(crd);
+            return i == npos ? nullptr : m_slots + i;
+        }
+
+        Slot const* find(coord_t crd) const
+        {
+            std::size_t const i = find_index(crd);
+            return i == npos ? nullptr : m_slots + i;
+        }
+
+        // Returns the slot of 'crd' and whether it was added. 'args'
+        // construct the slot only when it's added.
+        template<typename... Args>
+        std::pair<Slot*, bool> emplace(coord_t crd, Args&&... args)
+        {
+            std::size_t const i = find_index(crd);
+            if(i != npos)
+                return { m_slots + i, false };
+            return { insert_new(crd, std::forward<Args>(args)...), true };
+        }
+
+        bool erase(coord_t crd)
+        {
+            std::size_t const i = find_index(crd);
+            if(i == npos)
+                return false;
+            m_slots[i].~Slot();
+            --m_size;
+            // A group that still has an empty slot has never been full,
+            // so no probe has passed it and the slot can be empty again.
+            std::size_t const g = i & ~(group_width - 1);
+            if(group_t(&m_ctrl[g]).match_empty())
+            {
+                m_ctrl[i] = ctrl_empty;
+                ++m_growth_left;
+            }
+            else
+                m_ctrl[i] = ctrl_deleted;
+            return true;
+        }
+
+    private:
+        static constexpr std::size_t npos = ~std::size_t(0);
+
+        // 7/8ths of the slots.
+        static std::size_t max_load(std::size_t cap)
+        {
+            return cap - cap / 8;
+        }
+
+        static ctrl_t h2(std::uint64_t h) { return ctrl_t(h & 0x7F); }
+
+        ctrl_t const* ctrl_end() const
+        {
+            return m_ctrl.data() + m_capacity;
+        }
+
+        // Calls 'func(g)' with the index of the first slot of each group in
+        // probe order until it returns true. Triangular steps over a power
+        // of two number of groups visit every group.
+        template<typename Func>
+        void probe(std::uint64_t h, Func func) const
+        {
+            std::size_t const mask = m_capacity / group_width - 1;
+            std::size_t g = std::size_t(h >> 7) & mask;
+            for(std::size_t step = 1; !func(g * group_width); ++step)
+                g = (g + step) & mask;
+        }
+
+        std::size_t find_index(coord_t crd) const
+        {
+            if(m_capacity == 0)
+                return npos;
+            std::uint64_t const h = coord_hash(crd);
+            std::size_t ret = npos;
+            probe(h, [&](std::size_t g)
+            {
+                group_t const group(&m_ctrl[g]);
+                for(std::uint32_t m = group.match(h2(h)); m; m &= m - 1)
+                {
+                    std::size_t const i = g + lowest_bit(m);
+                    if(slot_key(m_slots[i]) == crd)
+                    {
+                        ret = i;
+                        return true;
+                    }
+                }
+                return group.match_empty() != 0;
+            });
+            return ret;
+        }
+
+        // The first empty or deleted slot along the probe sequence.
+        std::size_t free_index(std::uint64_t h) const
+        {
+            std::size_t ret = 0;
+            probe(h, [&](std::size_t g)
+            {
+                std::uint32_t const m = group_t(&m_ctrl[g]).match_free();
+                if(m)
+                    ret = g + lowest_bit(m);
+                return m != 0;
+            });
+            return ret;
+        }
+
+        // Adds 'crd', which must not be in the table.
+        template<typename... Args>
+        Slot* insert_new(coord_t crd, Args&&... args)
+        {
+            std::uint64_t const h = coord_hash(crd);
+            std::size_t i = m_capacity ? free_index(h) : 0;
+            if(m_capacity == 0
+               || (m_growth_left == 0 && m_ctrl[i] == ctrl_empty))
+            {
+                // Out of empty slots. Rehashing drops the deleted ones,
+                // and the size doubles only if the table is over half
+                // full of live elements.
+                std::size_t cap = m_capacity ? m_capacity : group_width;
+                if(m_size + 1 > max_load(cap) / 2)
+                    cap *= 2;
+                rehash(cap);
+                i = free_index(h);
+            }
+            ::new(static_cast<void*>(m_slots + i))
+                Slot(std::forward<Args>(args)...);
+            if(m_ctrl[i] == ctrl_empty)
+                --m_growth_left;
+            m_ctrl[i] = h2(h);
+            ++m_size;
+            return m_slots + i;
+        }
+
+        void rehash(std::size_t cap)
+        {
+            coord_table_t old;
+            swap(old);
+            m_ctrl.assign(cap, ctrl_empty);
+            m_slots = std::allocator<Slot>().allocate(cap);
+            m_capacity = cap;
+            m_growth_left = max_load(cap);
+            for(std::size_t i = 0; i < old.m_capacity; ++i)
+            {
+                if(old.m_ctrl[i] < 0)
+                    continue;
+                Slot& slot = old.m_slots[i];
+                std::uint64_t const h = coord_hash(slot_key(slot));
+                std::size_t const j = free_index(h);
+                ::new(static_cast<void*>(m_slots + j)) Slot(std::move(slot));
+                m_ctrl[j] = h2(h);
+                --m_growth_left;
+                ++m_size;
+            }
+        }
+
+        void destroy()
+        {
+            if(!m_slots)
+                return;
+            clear();
+            std::allocator<Slot>().deallocate(m_slots, m_capacity);
+            m_slots = nullptr;
+        }
+
+        std::vector<ctrl_t> m_ctrl;
+        Slot* m_slots = nullptr;
+        std::size_t m_capacity = 0;
+        std::size_t m_size = 0;
+        std::size_t m_growth_left = 0; // Empty slots left to fill.
+    };
+
+    template<typename Slot>
+    constexpr std::size_t coord_table_t<Slot>::npos;
+} // namespace impl
+
+// A set of coords.
+class coord_set_t
+{
+    using table_type = impl::coord_table_t<coord_t>;
+public:
+    using value_type = coord_t;
+    using iterator = table_type::const_iterator;
+    using const_iterator = table_type::const_iterator;
+
+    std::size_t size() const { return m_table.size(); }
+    bool empty() const { return m_table.empty(); }
+    std::size_t capacity() const { return m_table.capacity(); }
+    void reserve(std::size_t n) { m_table.reserve(n); }
+    void clear() { m_table.clear(); }
+
+    const_iterator begin() const { return m_table.begin(); }
+    const_iterator end() const { return m_table.end(); }
+
+    // Returns true if 'crd' was added.
+    bool insert(coord_t crd) { return m_table.emplace(crd, crd).second; }
+
+    // Returns true if 'crd' was removed.
+    bool erase(coord_t crd) { return m_table.erase(crd); }
+
+    bool contains(coord_t crd) const { return m_table.find(crd); }
+    std::size_t count(coord_t crd) const { return contains(crd); }
+
+    void swap(coord_set_t& o) noexcept { m_table.swap(o.m_table); }
+private:
+    table_type m_table;
+};
+
+// A map from coords to 'T'.
+template<typename T>
+class coord_map_t
+{
+    using table_type = impl::coord_table_t<std::pair<coord_t const, T>>;
+public:
+    using key_type = coord_t;
+    using mapped_type = T;
+    using value_type = std::pair<coord_t const, T>;
+    using iterator = typename table_type::iterator;
+    using const_iterator = typename table_type::const_iterator;
+
+    std::size_t size() const { return m_table.size(); }
+    bool empty() const { return m_table.empty(); }
+    std::size_t capacity() const { return m_table.capacity(); }
+    void reserve(std::size_t n) { m_table.reserve(n); }
+    void clear() { m_table.clear(); }
+
+    iterator begin() { return m_table.begin(); }
+    iterator end() { return m_table.end(); }
+    const_iterator begin() const { return m_table.begin(); }
+    const_iterator end() const { return m_table.end(); }
+
+    // The value of 'crd', or null if it isn't in the map.
+    T* find(coord_t crd)
+    {
+        value_type* slot = m_table.find(crd);
+        return slot ? &slot->second : nullptr;
+    }
+
+    T const* find(coord_t crd) const
+    {
+        value_type const* slot = m_table.find(crd);
+        return slot ? &slot->second : nullptr;
+    }
+
+    bool contains(coord_t crd) const { return m_table.find(crd); }
+    std::size_t count(coord_t crd) const { return contains(crd); }
+
+    // Default constructs the value of 'crd' if it isn't in the map.
+    T& operator[](coord_t crd) { return *try_emplace(crd).first; }
+
+    // Constructs the value of 'crd' from 'args' if it isn't in the map.
+    // Returns the value and whether it was added.
+    template<typename... Args>
+    std::pair<T*, bool> try_emplace(coord_t crd, Args&&... args)
+    {
+        auto const ret = m_table.emplace(
+            crd, std::piecewise_construct, std::forward_as_tuple(crd),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { &ret.first->second, ret.second };
+    }
+
+    // Returns true if 'crd' was added, and leaves its value otherwise.
+    bool insert(coord_t crd, T const& value)
+    {
+        return try_emplace(crd, value).second;
+    }
+
+    // Sets the value of 'crd'. Returns true if it was added.
+    bool insert_or_assign(coord_t crd, T const& value)
+    {
+        auto const ret = try_emplace(crd, value);
+        if(!ret.second)
+            *ret.first = value;
+        return ret.second;
+    }
+
+    // Returns true if 'crd' was removed.
+    bool erase(coord_t crd) { return m_table.erase(crd); }
+
+    void swap(coord_map_t& o) noexcept { m_table.swap(o.m_table); }
+private:
+    table_type m_table;
+};
+
+} // namespace i2d
+
+namespace std
+{
+    template<typename S>
+    struct hash<::i2d::basic_coord_t<S>>
+    {
+        std::size_t operator()(::i2d::basic_coord_t<S> crd) const
+        {
+            return static_cast<std::size_t>(::i2d::coord_hash(crd));
+        }
+    };
+} // namespace std
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef INT2D_DISC_HPP
+#define INT2D_DISC_HPP
+
+// Discs, rings, and ellipses as one horizontal span per row.
+//
+// A disc of radius 'r' holds the cells with dx*dx + dy*dy <= r*r + r,
+// which is the shape the midpoint circle algorithm outlines. Ellipses
+// round the same way, so an ellipse with equal radii is a disc.
+//
+// Spans are passed around as rect_t one row tall. Half widths for each
+// row are found incrementally without square roots, and come from a
+// constexpr table for radii up to 'disc_table_radius'.
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+// The half widths of a disc of radius 'R', indexed by |dy|.
+template<int2d_t R>
+struct disc_half_widths_t
+{
+    int2d_t w[R + 1];
+
+    constexpr int2d_t operator[](int2d_t dy) const { return w[dy]; }
+};
+
+template<int2d_t R>
+constexpr disc_half_widths_t<R> make_disc_half_widths()
+{
+    disc_half_widths_t<R> ret = {};
+    int2d_t x = R;
+    for(int2d_t dy = 0; dy <= R; ++dy)
+    {
+        while(x * x + dy * dy > R * R + R)
+            --x;
+        ret.w[dy] = x;
+    }
+    return ret;
+}
+
+template<int2d_t R>
+constexpr disc_half_widths_t<R> disc_half_widths = make_disc_half_widths<R>();
+
+// Radii up to this use a precomputed table.
+constexpr int2d_t disc_table_radius = 32;
+
+namespace impl
+{
+    // The half widths of every disc up to 'disc_table_radius', one after
+    // another. Radius r starts at index r * (r + 1) / 2.
+    struct disc_table_t
+    {
+        static constexpr std::size_t size =
+            (disc_table_radius + 1) * (disc_table_radius + 2) / 2;
+        std::int8_t w[size];
+    };
+
+    constexpr disc_table_t make_disc_table()
+    {
+        disc_table_t ret = {};
+        std::size_t i = 0;
+        for(int2d_t r = 0; r <= disc_table_radius; ++r)
+        {
+            int2d_t x = r;
+            for(int2d_t dy = 0; dy <= r; ++dy, ++i)
+            {
+                while(x * x + dy * dy > r * r + r)
+                    --x;
+                ret.w[i] = static_cast<std::int8_t>(x);
+            }
+        }
+        return ret;
+    }
+
+    constexpr disc_table_t disc_table = make_disc_table();
+
+    // Fills 'out' with the half widths of an ellipse, indexed by |dy|.
+    // Cells are inside when (dx / (rx + 1/2))^2 + (dy / (ry + 1/2))^2 <= 1.
+    inline void ellipse_half_widths(int2d_t rx, int2d_t ry,
+                                    std::vector<int2d_t>& out)
+    {
+        out.resize(ry + 1);
+        std::int64_t const ax = sqr(std::int64_t(2 * rx + 1));
+        std::int64_t const ay = sqr(std::int64_t(2 * ry + 1));
+        int2d_t x = rx;
+        for(int2d_t dy = 0; dy <= ry; ++dy)
+        {
+            while(x >= 0 && 4 * sqr(std::int64_t(x)) * ay
+                            + 4 * sqr(std::int64_t(dy)) * ax > ax * ay)
+                --x;
+            out[dy] = x;
+        }
+    }
+
+    inline void disc_half_widths(int2d_t r, std::vector<int2d_t>& out)
+    {
+        out.resize(r + 1);
+        if(r <= disc_table_radius)
+        {
+            std::size_t const base = std::size_t(r) * (r + 1) / 2;
+            for(int2d_t dy = 0; dy <= r; ++dy)
+                out[dy] = disc_table.w[base + dy];
+            return;
+        }
+        int2d_t x = r;
+        for(int2d_t dy = 0; dy <= r; ++dy)
+        {
+            while(std::int64_t(x) * x + std::int64_t(dy) * dy
+                  > std::int64_t(r) * r + r)
+                --x;
+            out[dy] = x;
+        }
+    }
+
+    // Calls 'func(rect_t)' for each row of a shape centered on 'center'
+    // with the given half widths, from top to bottom.
+    template<typename Func>
+    void symmetric_spans(coord_t center, std::vector<int2d_t> const& hw,
+                         Func& func)
+    {
+        int2d_t const ry = static_cast<int2d_t>(hw.size()) - 1;
+        for(int2d_t dy = -ry; dy <= ry; ++dy)
+        {
+            int2d_t const w = hw[dy < 0 ? -dy : dy];
+            if(w >= 0)
+                func(rect_t{ { center.x - w, center.y + dy },
+                             { 2 * w + 1, 1 } });
+        }
+    }
+
+    // Calls 'func(T* row, int2d_t length, coord_t start)' for each span
+    // passed to it, cropped to 'grid'.
+    template<typename Grid, typename Func>
+    auto grid_row_func(Grid& grid, Func& func)
+    {
+        return [&grid, &func](rect_t span)
+        {
+            span = crop(span, grid.dimen());
+            if(span.d.w > 0 && span.d.h > 0)
+                func(grid.data() + grid_index(grid.dimen(), span.c),
+                     span.d.w, span.c);
+        };
+    }
+} // namespace impl
+
+// The half width of row 'dy' of a disc of radius 'r', or -1 if the row
+// is outside the disc.
+inline int2d_t disc_half_width(int2d_t r, int2d_t dy)
+{
+    if(dy < 0)
+        dy = -dy;
+    if(dy > r)
+        return -1;
+    if(r <= disc_table_radius)
+        return impl::disc_table.w[std::size_t(r) * (r + 1) / 2 + dy];
+    std::int64_t const limit =
+        std::int64_t(r) * r + r - std::int64_t(dy) * dy;
+    // Integer square root, corrected for rounding.
+    int2d_t x = static_cast<int2d_t>(std::sqrt(static_cast<double>(limit)));
+    while(std::int64_t(x) * x > limit)
+        --x;
+    while(std::int64_t(x + 1) * (x + 1) <= limit)
+        ++x;
+    return x;
+}
+
+// Calls 'func(rect_t)' with each row of the disc, top to bottom.
+template<typename Func>
+void disc_spans(coord_t center, int2d_t radius, Func func)
+{
+    if(radius < 0)
+        return;
+    if(radius <= disc_table_radius)
+    {
+        std::size_t const base = std::size_t(radius) * (radius + 1) / 2;
+        for(int2d_t dy = -radius; dy <= radius; ++dy)
+        {
+            int2d_t const ady = dy < 0 ? -dy : dy;
+            int2d_t const w = impl::disc_table.w[base + ady];
+            func(rect_t{ { center.x - w, center.y + dy },
+                         { 2 * w + 1, 1 } });
+        }
+        return;
+    }
+    std::vector<int2d_t> hw;
+    impl::disc_half_widths(radius, hw);
+    impl::symmetric_spans(center, hw, func);
+}
+
+// Calls 'func(rect_t)' with the spans of the cells within 'outer' of
+// 'center' but not within 'inner - 1', top to bottom and left to right.
+// Rows crossing the hole have two spans.
+template<typename Func>
+void annulus_spans(coord_t center, int2d_t inner, int2d_t outer, Func func)
+{
+    if(inner <= 0)
+    {
+        disc_spans(center, outer, func);
+        return;
+    }
+    if(outer < inner)
+        return;
+    std::vector<int2d_t> ho, hi;
+    impl::disc_half_widths(outer, ho);
+    impl::disc_half_widths(inner - 1, hi);
+    for(int2d_t dy = -outer; dy <= outer; ++dy)
+    {
+        int2d_t const ady = dy < 0 ? -dy : dy;
+        int2d_t const o = ho[ady];
+        int2d_t const y = center.y + dy;
+        if(ady >= static_cast<int2d_t>(hi.size()))
+        {
+            func(rect_t{ { center.x - o, y }, { 2 * o + 1, 1 } });
+            continue;
+        }
+        int2d_t const i = hi[ady];
+        if(o > i)
+        {
+            func(rect_t{ { center.x - o, y }, { o - i, 1 } });
+            func(rect_t{ { center.x + i + 1, y }, { o - i, 1 } });
+        }
+    }
+}
+
+// Calls 'func(rect_t)' with each row of the axis-aligned ellipse with
+// radii 'rx' and 'ry', top to bottom.
+template<typename Func>
+void ellipse_spans(coord_t center, int2d_t rx, int2d_t ry, Func func)
+{
+    if(rx < 0 || ry < 0)
+        return;
+    std::vector<int2d_t> hw;
+    impl::ellipse_half_widths(rx, ry, hw);
+    impl::symmetric_spans(center, hw, func);
+}
+
+// Grid-aware versions. These crop each span to 'grid' and call
+// 'func(T* row, int2d_t length, coord_t start)', where 'row' points to
+// the cell at 'start'. Pass a const grid for const pointers.
+
+template<typename Grid, typename Func>
+void for_each_disc_row(Grid& grid, coord_t center, int2d_t radius,
+                       Func func)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    disc_spans(center, radius, impl::grid_row_func(grid, func));
+}
+
+template<typename Grid, typename Func>
+void for_each_annulus_row(Grid& grid, coord_t center, int2d_t inner,
+                          int2d_t outer, Func func)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    annulus_spans(center, inner, outer, impl::grid_row_func(grid, func));
+}
+
+template<typename Grid, typename Func>
+void for_each_ellipse_row(Grid& grid, coord_t center, int2d_t rx,
+                          int2d_t ry, Func func)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    ellipse_spans(center, rx, ry, impl::grid_row_func(grid, func));
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,419 @@
+#ifndef INT2D_FLOW_FIELD_HPP
+#define INT2D_FLOW_FIELD_HPP
+
+// Flow fields for moving many agents toward shared goals.
+//
+// The integration field holds the cost of the cheapest path from each
+// cell to the nearest goal. The direction field points each cell at its
+// cheapest neighbor, so an agent only needs to look up its own cell.
+//
+// Movement is 8-way with no corner cutting. Entering a cell costs its
+// value in the cost grid, times 10 for orthogonal steps and 14 for
+// diagonal steps.
+//
+// The integration field is computed in square tiles. Each tile runs a
+// Dijkstra search seeded only from the cells whose values just changed:
+// goals, cells reset by an update, and edge cells that improve from the
+// cells bordering the tile. Tiles whose edges improve wake up their
+// neighbors. Tiles that don't touch are processed in parallel.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+// 'T' is the value type of the cost grids passed in.
+// Cells holding the 'wall' value are impassable.
+template<typename T>
+class flow_field_t
+{
+public:
+    using value_type = std::uint32_t;
+    static constexpr value_type unreachable =
+        std::numeric_limits<value_type>::max();
+    static constexpr int2d_t tile_size = 32;
+
+    explicit flow_field_t(T wall = std::numeric_limits<T>::max())
+    : m_wall(wall)
+    {}
+
+    // Computes both fields from scratch.
+    // Bands passed to 'parallel_bands' are measured in tiles.
+    template<typename Grid, typename It>
+    void build(Grid const& costs, It goals_begin, It goals_end,
+               parallel_opts_t opts = { 4, 0 })
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        dimen_t const dim = costs.dimen();
+        m_goals.assign(goals_begin, goals_end);
+        m_integration.assign_uninitialized(dim);
+        m_integration.fill(unreachable);
+        m_dirs.assign_uninitialized(dim);
+        m_reset.assign_uninitialized(dim);
+        m_reset.fill(0);
+        m_tiles = { (dim.w + tile_size - 1) / tile_size,
+                    (dim.h + tile_size - 1) / tile_size };
+        m_active.reset(new std::atomic<std::uint8_t>[area(m_tiles)]);
+        for(int2d_t i = 0; i < area(m_tiles); ++i)
+            m_active[i] = 0;
+        m_changed.assign(area(m_tiles), 1);
+        m_seeds.assign(area(m_tiles), {});
+
+        for(coord_t goal : m_goals)
+        {
+            if(!in_bounds(goal, dim) || !passable(costs, goal))
+                continue;
+            m_integration[goal] = 0;
+            std::size_t const tile = tile_index(tile_of(goal));
+            m_active[tile] = 1;
+            m_seeds[tile].push_back(goal);
+        }
+
+        relax(costs, opts);
+        update_dirs(costs, opts);
+    }
+
+    // Call this after the costs of cells within 'changed' have changed.
+    // Only the cells whose paths went through 'changed' and the tiles
+    // that can improve because of it are recomputed.
+    template<typename Grid>
+    void update(Grid const& costs, rect_t changed,
+                parallel_opts_t opts = { 4, 0 })
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(costs.dimen() == dimen());
+        changed = crop(changed, dimen());
+        if(!changed)
+            return;
+        std::fill(m_changed.begin(), m_changed.end(), 0);
+
+        // Every cell whose cheapest path passes through 'changed' may now
+        // have the wrong value. These get reset and recomputed.
+        // Cells next to 'changed' are included too, as diagonal steps
+        // between them may have become corner cuts.
+        rect_t const seeds = crop(rect_margin(changed, -1), dimen());
+        std::vector<std::pair<coord_t, value_type> > stack;
+        std::vector<coord_t> reset;
+        auto const push = [&](coord_t crd)
+        {
+            m_reset[crd] = 1;
+            reset.push_back(crd);
+            stack.push_back({ crd, m_integration[crd] });
+            m_integration[crd] = unreachable;
+            std::size_t const tile = tile_index(tile_of(crd));
+            m_active[tile] = 1;
+            m_changed[tile] = 1;
+            m_seeds[tile].push_back(crd);
+        };
+        for(coord_t crd : rect_range(seeds))
+            push(crd);
+        while(!stack.empty())
+        {
+            coord_t const crd = stack.back().first;
+            value_type const old = stack.back().second;
+            stack.pop_back();
+            if(old == unreachable)
+                continue;
+            for(coord_t dir : dir_range)
+            {
+                coord_t const to = crd + dir;
+                if(!in_bounds(to, dimen()) || m_reset[to])
+                    continue;
+                value_type const v = m_integration[to];
+                if(v != 0 && v != unreachable
+                   && v == old + step_cost(costs, crd, dir))
+                    push(to);
+            }
+        }
+        for(coord_t crd : reset)
+            m_reset[crd] = 0;
+
+        for(coord_t goal : m_goals)
+            if(in_bounds(goal, dimen()) && passable(costs, goal))
+                m_integration[goal] = 0;
+
+        relax(costs, opts);
+        update_dirs(costs, opts);
+    }
+
+    dimen_t dimen() const { return m_integration.dimen(); }
+
+    // Path costs to the nearest goal, or 'unreachable'.
+    grid_t<value_type> const& integration() const { return m_integration; }
+
+    // Indexes into 'dir_range'. Goals, walls, and cells that can't reach
+    // a goal hold NUM_DIRS.
+    grid_t<dir_t> const& directions() const { return m_dirs; }
+
+    dir_t operator[](coord_t crd) const { return m_dirs[crd]; }
+
+    // The cell an agent at 'crd' should move to next.
+    coord_t next(coord_t crd) const
+    {
+        dir_t const dir = m_dirs[crd];
+        return dir == NUM_DIRS ? crd : crd + dir_range[dir];
+    }
+private:
+    template<typename Grid>
+    bool passable(Grid const& costs, coord_t crd) const
+    {
+        return costs[crd] != m_wall;
+    }
+
+    // Whether a step from 'from' in direction 'dir' is allowed,
+    // assuming both ends are in bounds and passable.
+    template<typename Grid>
+    bool can_step(Grid const& costs, coord_t from, coord_t dir) const
+    {
+        return (!dir.x || !dir.y
+                || (passable(costs, coord_t{ from.x + dir.x, from.y })
+                    && passable(costs, coord_t{ from.x, from.y + dir.y })));
+    }
+
+    // The cost of stepping along 'dir' or its reverse into 'entered'.
+    template<typename Grid>
+    value_type step_cost(Grid const& costs, coord_t entered,
+                         coord_t dir) const
+    {
+        value_type const scale = dir.x && dir.y ? 14 : 10;
+        return static_cast<value_type>(costs[entered]) * scale;
+    }
+
+    coord_t tile_of(coord_t crd) const
+    {
+        return { crd.x / tile_size, crd.y / tile_size };
+    }
+
+    std::size_t tile_index(coord_t tile) const
+    {
+        return grid_index(m_tiles, tile);
+    }
+
+    rect_t tile_rect(coord_t tile) const
+    {
+        return crop(rect_t{ vec_mul(tile, tile_size),
+                            square_dimen(tile_size) }, dimen());
+    }
+
+    // Runs active tiles until nothing changes. Tiles are processed in
+    // four phases by the parity of their coordinates, so that tiles
+    // running at the same time never touch each other's cells.
+    template<typename Grid>
+    void relax(Grid const& costs, parallel_opts_t opts)
+    {
+        std::vector<coord_t> batch;
+        bool any = true;
+        while(any)
+        {
+            any = false;
+            for(int2d_t phase = 0; phase < 4; ++phase)
+            {
+                batch.clear();
+                for(int2d_t ty = phase / 2; ty < m_tiles.h; ty += 2)
+                for(int2d_t tx = phase % 2; tx < m_tiles.w; tx += 2)
+                {
+                    std::size_t const i = tile_index({ tx, ty });
+                    if(m_active[i])
+                    {
+                        m_active[i] = 0;
+                        batch.push_back({ tx, ty });
+                    }
+                }
+                if(batch.empty())
+                    continue;
+                any = true;
+                parallel_bands(0, batch.size(), [&](int2d_t b, int2d_t e)
+                {
+                    for(int2d_t i = b; i < e; ++i)
+                        relax_tile(costs, batch[i]);
+                }, opts);
+            }
+        }
+    }
+
+    template<typename Grid>
+    void relax_tile(Grid const& costs, coord_t tile)
+    {
+        rect_t const r = tile_rect(tile);
+        bool edge_changed = false;
+        bool changed = false;
+
+        using entry_t = std::pair<value_type, coord_t>;
+        auto const cmp = [](entry_t const& a, entry_t const& b)
+        {
+            return a.first > b.first;
+        };
+        std::priority_queue<entry_t, std::vector<entry_t>, decltype(cmp)>
+            open(cmp);
+
+        auto const lower = [&](coord_t crd, value_type value)
+        {
+            m_integration[crd] = value;
+            changed = true;
+            if(crd.x == r.c.x || crd.y == r.c.y
+               || crd.x == r.rx() || crd.y == r.ry())
+                edge_changed = true;
+        };
+
+        // Lowers 'crd' from its neighbors that 'use' accepts.
+        auto const pull = [&](coord_t crd, auto use)
+        {
+            if(!passable(costs, crd))
+                return;
+            for(coord_t dir : dir_range)
+            {
+                coord_t const from = crd - dir;
+                if(!in_bounds(from, dimen()) || !use(from))
+                    continue;
+                value_type const v = m_integration[from];
+                if(v == unreachable || !can_step(costs, from, dir))
+                    continue;
+                value_type const cost = v + step_cost(costs, from, dir);
+                if(cost < m_integration[crd])
+                {
+                    lower(crd, cost);
+                    open.push({ cost, crd });
+                }
+            }
+        };
+
+        // Only cells whose values dropped need to be searched from: the
+        // goals and reset cells queued by 'build' and 'update', and the
+        // edge cells that improve from the cells bordering the tile.
+        std::vector<coord_t>& seeds = m_seeds[tile_index(tile)];
+        for(coord_t crd : seeds)
+        {
+            value_type const v = m_integration[crd];
+            if(v != unreachable)
+            {
+                lower(crd, v);
+                open.push({ v, crd });
+            }
+            pull(crd, [](coord_t) { return true; });
+        }
+        seeds.clear();
+
+        auto const outside = [&r](coord_t from) { return !in_bounds(from, r); };
+        for(int2d_t x = r.c.x; x < r.ex(); ++x)
+        {
+            pull(coord_t{ x, r.c.y }, outside);
+            pull(coord_t{ x, r.ry() }, outside);
+        }
+        for(int2d_t y = r.c.y + 1; y < r.ry(); ++y)
+        {
+            pull(coord_t{ r.c.x, y }, outside);
+            pull(coord_t{ r.rx(), y }, outside);
+        }
+
+        if(open.empty())
+            return;
+
+        while(!open.empty())
+        {
+            entry_t const top = open.top();
+            open.pop();
+            if(top.first != m_integration[top.second])
+                continue; // Stale entry.
+            for(coord_t dir : dir_range)
+            {
+                coord_t const to = top.second + dir;
+                if(!in_bounds(to, r) || !passable(costs, to)
+                   || !can_step(costs, top.second, dir))
+                    continue;
+                value_type const cost = top.first
+                                        + step_cost(costs, top.second, dir);
+                if(cost < m_integration[to])
+                {
+                    lower(to, cost);
+                    open.push({ cost, to });
+                }
+            }
+        }
+
+        if(changed)
+            m_changed[tile_index(tile)] = 1;
+        if(edge_changed)
+        {
+            for(coord_t dir : dir_range)
+                if(in_bounds(tile + dir, m_tiles))
+                    m_active[tile_index(tile + dir)] = 1;
+        }
+    }
+
+    // Recomputes directions in every tile that changed or borders a
+    // tile that changed.
+    template<typename Grid>
+    void update_dirs(Grid const& costs, parallel_opts_t opts)
+    {
+        auto const needs_update = [&](coord_t tile)
+        {
+            for(coord_t t : rect_range(rect_from_radius(tile, 1)))
+                if(in_bounds(t, m_tiles) && m_changed[tile_index(t)])
+                    return true;
+            return false;
+        };
+
+        parallel_bands(0, m_tiles.h, [&](int2d_t b, int2d_t e)
+        {
+            for(int2d_t ty = b; ty < e; ++ty)
+            for(int2d_t tx = 0; tx < m_tiles.w; ++tx)
+            {
+                if(!needs_update({ tx, ty }))
+                    continue;
+                for(coord_t crd : rect_range(tile_rect({ tx, ty })))
+                    m_dirs[crd] = best_dir(costs, crd);
+            }
+        }, opts);
+    }
+
+    template<typename Grid>
+    dir_t best_dir(Grid const& costs, coord_t crd) const
+    {
+        value_type best = m_integration[crd];
+        dir_t ret = NUM_DIRS;
+        if(best == unreachable || best == 0)
+            return ret;
+        for(dir_t d = FIRST_DIR; d != NUM_DIRS; ++d)
+        {
+            coord_t const to = crd + dir_range[d];
+            if(!in_bounds(to, dimen()) || m_integration[to] >= best
+               || !can_step(costs, crd, dir_range[d]))
+                continue;
+            best = m_integration[to];
+            ret = d;
+        }
+        return ret;
+    }
+
+    T m_wall;
+    std::vector<coord_t> m_goals;
+    grid_t<value_type> m_integration;
+    grid_t<dir_t> m_dirs;
+    grid_t<std::uint8_t> m_reset; // Marks cells reset by 'update'.
+    std::vector<std::vector<coord_t> > m_seeds; // Per tile.
+    dimen_t m_tiles = { 0, 0 };
+    std::unique_ptr<std::atomic<std::uint8_t>[]> m_active;
+    std::vector<std::uint8_t> m_changed;
+};
+
+template<typename T>
+constexpr typename flow_field_t<T>::value_type flow_field_t<T>::unreachable;
+
+template<typename T>
+constexpr int2d_t flow_field_t<T>::tile_size;
+
+} // namespace i2d
+
+#endif
@@ -10,29 +10,39 @@
 #include <utility>
 #include <vector>
 
+#include "instrument.hpp"
 #include "units.hpp"
 
 namespace i2d {
 
-constexpr coord_t left_n(coord_t c, int2d_t n)  
-    { return coord_t{ c.x - n, c.y }; }
-constexpr coord_t right_n(coord_t c, int2d_t n)
-    { return coord_t{ c.x + n, c.y }; }
-constexpr coord_t up_n(coord_t c, int2d_t n)
-    { return coord_t{ c.x, c.y - n }; }
-constexpr coord_t down_n(coord_t c, int2d_t n)
-    { return coord_t{ c.x, c.y + n }; }
-
-constexpr coord_t left1(coord_t c)  { return left_n(c, 1); }
-constexpr coord_t right1(coord_t c) { return right_n(c, 1); }
-constexpr coord_t up1(coord_t c)    { return up_n(c, 1); }
-constexpr coord_t down1(coord_t c)  { return down_n(c, 1); }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> left_n(basic_coord_t<S> c, scalar_arg_t<S> n)
+    { return { S(c.x - n), c.y }; }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> right_n(basic_coord_t<S> c, scalar_arg_t<S> n)
+    { return { S(c.x + n), c.y }; }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> up_n(basic_coord_t<S> c, scalar_arg_t<S> n)
+    { return { c.x, S(c.y - n) }; }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> down_n(basic_coord_t<S> c, scalar_arg_t<S> n)
+    { return { c.x, S(c.y + n) }; }
+
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> left1(basic_coord_t<S> c)  { return left_n(c, 1); }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> right1(basic_coord_t<S> c) { return right_n(c, 1); }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> up1(basic_coord_t<S> c)    { return up_n(c, 1); }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> down1(basic_coord_t<S> c)  { return down_n(c, 1); }
 
 namespace impl {
     template<typename T>
     constexpr auto sqr(T t) { return t * t; }
 
-    inline int2d_t gcd(int2d_t a, int2d_t b)
+    template<typename S>
+    S gcd(S a, S b)
     {
         while (b != 0)
         {
@@ -41,17 +51,28 @@ namespace impl {
         }
         return a;
     }
+
+    template<typename S>
+    constexpr promoted_t<S> abs_diff(S a, S b)
+    {
+        return a < b ? b - a : a - b;
+    }
 } // namespace impl
 
-template<typename T = int2d_t>
-constexpr T dot_product(coord_t c1, coord_t c2)
+// 'T' defaults to 'promoted_t<S>'.
+template<typename T = void, typename S,
+         typename R = std::conditional_t<std::is_void<T>::value,
+                                         promoted_t<S>, T>>
+constexpr R dot_product(basic_coord_t<S> c1, basic_coord_t<S> c2)
 {
-    return (static_cast<T>(c1.x) * static_cast<T>(c2.x)
-            + static_cast<T>(c1.y) * static_cast<T>(c2.y));
+    return (static_cast<R>(c1.x) * static_cast<R>(c2.x)
+            + static_cast<R>(c1.y) * static_cast<R>(c2.y));
 }
 
-constexpr int2d_t area(dimen_t d) { return d.w * d.h; }
-constexpr int2d_t area(rect_t r) { return area(r.d); }
+template<typename S = int2d_t>
+constexpr promoted_t<S> area(basic_dimen_t<S> d) { return d.w * d.h; }
+template<typename S = int2d_t>
+constexpr promoted_t<S> area(basic_rect_t<S> r) { return area(r.d); }
 
 // Given a 5x3 rect_t:
 //   -----
@@ -61,39 +82,53 @@ constexpr int2d_t area(rect_t r) { return area(r.d); }
 //   -----
 //   perimeter: number of | and - characters (16)
 //   inner_perimeter: number of x characters (12)
-constexpr int2d_t perimeter(dimen_t d) { return 2 * d.w + 2 * d.h; }
-constexpr int2d_t perimeter(rect_t r) { return perimeter(r.d); }
-constexpr int2d_t inner_perimeter(dimen_t d) { return 2*(d.w-1) + 2*(d.h-1); }
-constexpr int2d_t inner_perimeter(rect_t r) { return inner_perimeter(r.d); }
+template<typename S = int2d_t>
+constexpr promoted_t<S> perimeter(basic_dimen_t<S> d)
+    { return 2 * d.w + 2 * d.h; }
+template<typename S = int2d_t>
+constexpr promoted_t<S> perimeter(basic_rect_t<S> r)
+    { return perimeter(r.d); }
+template<typename S = int2d_t>
+constexpr promoted_t<S> inner_perimeter(basic_dimen_t<S> d)
+    { return 2*(d.w-1) + 2*(d.h-1); }
+template<typename S = int2d_t>
+constexpr promoted_t<S> inner_perimeter(basic_rect_t<S> r)
+    { return inner_perimeter(r.d); }
 
-inline int2d_t c_dist(coord_t c1, coord_t c2) // chess distance
+template<typename S = int2d_t> // chess distance
+promoted_t<S> c_dist(basic_coord_t<S> c1, basic_coord_t<S> c2)
 {
-    return std::max(std::abs(c1.x - c2.x), std::abs(c1.y - c2.y));
+    return std::max(impl::abs_diff(c1.x, c2.x), impl::abs_diff(c1.y, c2.y));
 }
 
-inline int2d_t m_dist(coord_t c1, coord_t c2) // manhattan distance
+template<typename S = int2d_t> // manhattan distance
+promoted_t<S> m_dist(basic_coord_t<S> c1, basic_coord_t<S> c2)
 {
-    return std::abs(c1.x - c2.x) + std::abs(c1.y - c2.y);
+    return impl::abs_diff(c1.x, c2.x) + impl::abs_diff(c1.y, c2.y);
 }
 
-inline double e_dist(coord_t c1, coord_t c2) // euclidian distance
+template<typename S = int2d_t> // euclidian distance
+double e_dist(basic_coord_t<S> c1, basic_coord_t<S> c2)
 {
-    return std::sqrt(double(impl::sqr(c1.x - c2.x) + impl::sqr(c1.y - c2.y)));
+    return std::sqrt(impl::sqr(double(c1.x) - double(c2.x))
+                     + impl::sqr(double(c1.y) - double(c2.y)));
 }
 
 // Reduces the fraction representind direction
-inline coord_t simplify_dir(coord_t direction)
+template<typename S = int2d_t>
+basic_coord_t<S> simplify_dir(basic_coord_t<S> direction)
 {
-    int2d_t const gcd_value = impl::gcd(direction.x, direction.y);
+    S const gcd_value = impl::gcd(direction.x, direction.y);
     components([&direction, gcd_value](auto c)
                { direction[c] /= gcd_value; });
     return direction;
 }
 
 // Returns in range [-pi, pi].
-inline double dir_to_rad(coord_t dir)
+template<typename S = int2d_t>
+double dir_to_rad(basic_coord_t<S> dir)
 {
-    return std::atan2(-dir.y, dir.x);
+    return std::atan2(-double(dir.y), double(dir.x));
 }
 
 inline coord_t rad_to_dir(double rad, int2d_t length)
@@ -105,7 +140,8 @@ inline coord_t rad_to_dir(double rad, int2d_t length)
     };
 }
 
-constexpr dimen_t rotate(dimen_t dimen, int2d_t rotations)
+template<typename S = int2d_t>
+constexpr basic_dimen_t<S> rotate(basic_dimen_t<S> dimen, int2d_t rotations)
 {
     if((unsigned)rotations & 1)
         return { dimen.h, dimen.w };
@@ -113,28 +149,39 @@ constexpr dimen_t rotate(dimen_t dimen, int2d_t rotations)
         return dimen;
 }
 
-constexpr rect_t rotated_rect(coord_t upper_left, dimen_t dimen, 
-                              int2d_t rotations)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rotated_rect(basic_coord_t<S> upper_left,
+                                       basic_dimen_t<S> dimen,
+                                       int2d_t rotations)
 {
     return { upper_left, rotate(dimen, rotations) };
 }
 
-constexpr rect_t to_rect(dimen_t dim) { return { {0,0}, dim }; }
-constexpr coord_t to_coord(dimen_t dim) { return { dim.w, dim.h }; }
-constexpr dimen_t to_dimen(coord_t crd) { return { crd.x, crd.y }; }
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> to_rect(basic_dimen_t<S> dim)
+    { return { {0,0}, dim }; }
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> to_coord(basic_dimen_t<S> dim)
+    { return { dim.w, dim.h }; }
+template<typename S = int2d_t>
+constexpr basic_dimen_t<S> to_dimen(basic_coord_t<S> crd)
+    { return { crd.x, crd.y }; }
 
-constexpr bool in_bounds(coord_t crd, rect_t r)
+template<typename S = int2d_t>
+constexpr bool in_bounds(basic_coord_t<S> crd, basic_rect_t<S> r)
 {
     return (crd.x >= r.c.x && crd.y >= r.c.y
             && crd.x < r.ex() && crd.y < r.ey());
 }
 
-constexpr bool in_bounds(coord_t crd, dimen_t dim)
+template<typename S = int2d_t>
+constexpr bool in_bounds(basic_coord_t<S> crd, basic_dimen_t<S> dim)
 {
     return in_bounds(crd, to_rect(dim));
 }
 
-constexpr bool in_bounds(rect_t sub, rect_t super)
+template<typename S = int2d_t>
+constexpr bool in_bounds(basic_rect_t<S> sub, basic_rect_t<S> super)
 {
     return (sub.c.x >= super.c.x
             && sub.c.y >= super.c.y
@@ -142,215 +189,262 @@ constexpr bool in_bounds(rect_t sub, rect_t super)
             && sub.ey() <= super.ey());
 }
 
-constexpr bool in_bounds(rect_t sub, dimen_t dim)
+template<typename S = int2d_t>
+constexpr bool in_bounds(basic_rect_t<S> sub, basic_dimen_t<S> dim)
 {
     return in_bounds(sub, to_rect(dim));
 }
 
-constexpr bool in_bounds(dimen_t sub, dimen_t super)
+template<typename S = int2d_t>
+constexpr bool in_bounds(basic_dimen_t<S> sub, basic_dimen_t<S> super)
 {
     return in_bounds(to_rect(sub), to_rect(super));
 }
 
-constexpr bool overlapping(rect_t r1, rect_t r2)
+template<typename S = int2d_t>
+constexpr bool overlapping(basic_rect_t<S> r1, basic_rect_t<S> r2)
 {
     return (r1.c.x < r2.ex() && r1.ex() > r2.c.x
             && r1.c.y < r2.ey() && r1.ey() > r2.c.y);
 }
 
 // Minimum bounding box that contains 2 coords
-inline rect_t rect_from_2_coords(coord_t c1, coord_t c2)
+template<typename S = int2d_t>
+basic_rect_t<S> rect_from_2_coords(basic_coord_t<S> c1, basic_coord_t<S> c2)
 {
     using std::swap;
     if(c1.x > c2.x)
         swap(c1.x, c2.x);
     if(c1.y > c2.y)
         swap(c1.y, c2.y);
-    return { c1, { c2.x - c1.x + 1, c2.y - c1.y + 1 } };
+    return { c1, { S(c2.x - c1.x + 1), S(c2.y - c1.y + 1) } };
 }
 
-template<typename It>
-rect_t rect_from_n_coords(It begin, It end)
+// Minimum bounding box that contains every coord in [begin, end).
+// Empty ranges give an empty rect.
+template<typename It,
+         typename Crd = typename std::iterator_traits<It>::value_type,
+         typename S = typename Crd::value_type>
+basic_rect_t<S> rect_from_n_coords(It begin, It end)
 {
-    coord_t c = *begin;
-    coord_t e = *begin;
-    for(It it = begin; it != end; ++it)
+    if(begin == end)
+        return { { 0, 0 }, { 0, 0 } };
+    basic_coord_t<S> c = *begin;
+    basic_coord_t<S> e = *begin;
+    for(It it = std::next(begin); it != end; ++it)
     {
-        c.x = std::min(c.x, it->x);
-        c.y = std::min(c.y, it->y);
-        e.x = std::max(e.x, it->x);
-        e.y = std::max(e.y, it->y);
+        basic_coord_t<S> const crd = *it;
+        c.x = std::min(c.x, crd.x);
+        c.y = std::min(c.y, crd.y);
+        e.x = std::max(e.x, crd.x);
+        e.y = std::max(e.y, crd.y);
     }
-    return { c, { e.x - c.x + 1, e.y - c.y + 1 } };
+    return { c, { S(e.x - c.x + 1), S(e.y - c.y + 1) } };
 }
 
-inline rect_t grow_rect_to_contain(rect_t r, coord_t to_hold)
+template<typename S = int2d_t>
+basic_rect_t<S> grow_rect_to_contain(basic_rect_t<S> r,
+                                     basic_coord_t<S> to_hold)
 {
     if(area(r) == 0)
         return {to_hold, {1,1}};
 
-    std::array<coord_t, 5> crds =
-    {{
-        to_hold,
-        r.nw(),
-        r.ne(),
-        r.sw(),
-        r.se(),
-    }};
-    return rect_from_n_coords(crds.begin(), crds.end());
+    basic_coord_t<S> const c = { std::min(r.c.x, to_hold.x),
+                                 std::min(r.c.y, to_hold.y) };
+    basic_coord_t<S> const e = { std::max(r.ex(), S(to_hold.x + 1)),
+                                 std::max(r.ey(), S(to_hold.y + 1)) };
+    return { c, { S(e.x - c.x), S(e.y - c.y) } };
 }
 
-inline rect_t grow_rect_to_contain(rect_t r1, rect_t r2)
+template<typename S = int2d_t>
+basic_rect_t<S> grow_rect_to_contain(basic_rect_t<S> r1, basic_rect_t<S> r2)
 {
     if(area(r1) == 0)
         return r2;
     if(area(r2) == 0)
         return r1;
 
-    std::array<coord_t, 8> crds =
-    {{
-        r1.nw(), r1.ne(), r1.sw(), r1.se(),
-        r2.nw(), r2.ne(), r2.sw(), r2.se(),
-    }};
-    return rect_from_n_coords(crds.begin(), crds.end());
+    basic_coord_t<S> const c = { std::min(r1.c.x, r2.c.x),
+                                 std::min(r1.c.y, r2.c.y) };
+    basic_coord_t<S> const e = { std::max(r1.ex(), r2.ex()),
+                                 std::max(r1.ey(), r2.ey()) };
+    return { c, { S(e.x - c.x), S(e.y - c.y) } };
 }
 
-inline dimen_t grow_dimen_to_contain(dimen_t a, dimen_t b)
+template<typename S = int2d_t>
+basic_dimen_t<S> grow_dimen_to_contain(basic_dimen_t<S> a, basic_dimen_t<S> b)
 {
     return { std::max(a.w, b.w), std::max(a.h, b.h), };
 }
 
-inline coord_t crop(coord_t crd, rect_t super)
+template<typename S = int2d_t>
+basic_coord_t<S> crop(basic_coord_t<S> crd, basic_rect_t<S> super)
 {
     crd.x = std::min(std::max(crd.x, super.c.x), super.rx());
     crd.y = std::min(std::max(crd.y, super.c.y), super.ry());
     return crd;
 }
 
-inline dimen_t crop(dimen_t too_big, dimen_t crop_boundary)
+template<typename S = int2d_t>
+constexpr basic_dimen_t<S> crop(basic_dimen_t<S> too_big,
+                                basic_dimen_t<S> crop_boundary)
 {
-    components(
-        [&](auto c) { too_big[c] = std::min(too_big[c], crop_boundary[c]); });
-    return too_big;
+    return { std::min(too_big.w, crop_boundary.w),
+             std::min(too_big.h, crop_boundary.h) };
 }
 
-inline rect_t crop(rect_t too_big, rect_t crop_boundary)
+template<typename S = int2d_t>
+basic_rect_t<S> crop(basic_rect_t<S> too_big, basic_rect_t<S> crop_boundary)
 {
     if(!too_big || !crop_boundary || !overlapping(too_big, crop_boundary))
         return {};
-    coord_t c1 = crop(too_big.c, crop_boundary);
-    coord_t c2 = crop(too_big.r(), crop_boundary);
+    basic_coord_t<S> c1 = crop(too_big.c, crop_boundary);
+    basic_coord_t<S> c2 = crop(too_big.r(), crop_boundary);
     return rect_from_2_coords(c1, c2);
 }
 
-inline rect_t crop(rect_t too_big, dimen_t crop_boundary)
+template<typename S = int2d_t>
+basic_rect_t<S> crop(basic_rect_t<S> too_big, basic_dimen_t<S> crop_boundary)
 {
     return crop(too_big, to_rect(crop_boundary));
 }
 
-inline rect_t rect_from_radius(coord_t center, int2d_t rad)
+template<typename S = int2d_t>
+basic_rect_t<S> rect_from_radius(basic_coord_t<S> center, scalar_arg_t<S> rad)
 {
-    int2d_t const d = rad*2 + 1;
-    return { center - coord_t{rad,rad}, dimen_t{d,d} };
+    S const d = S(rad*2 + 1);
+    return { center - basic_coord_t<S>{rad,rad}, basic_dimen_t<S>{d,d} };
 }
 
-inline coord_t rect_center(rect_t r)
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> rect_center(basic_rect_t<S> r)
 {
-    return { (r.c.x + r.ex()) / 2, (r.c.y + r.ey()) / 2 };
+    return { S((r.c.x + r.ex()) / 2), S((r.c.y + r.ey()) / 2) };
 }
 
-inline rect_t centered_rect(coord_t center_point, dimen_t dim)
+template<typename S = int2d_t>
+basic_rect_t<S> centered_rect(basic_coord_t<S> center_point,
+                              basic_dimen_t<S> dim)
 {
-    rect_t r;
+    basic_rect_t<S> r;
     components([&](auto c) { r.c[c] = center_point[c] - dim[c] / 2; });
     r.d = dim;
     return r;
 }
 
-inline rect_t centered_inside(dimen_t dim, rect_t in)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> centered_inside(basic_dimen_t<S> dim,
+                                          basic_rect_t<S> in)
 {
     dim = crop(dim, in.d);
-    coord_t center = rect_center(in);
+    basic_coord_t<S> const center = rect_center(in);
     return { center - to_coord(dim/2), dim };
 }
 
-inline rect_t lmargin(rect_t r, int2d_t margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> lmargin(basic_rect_t<S> r, scalar_arg_t<S> margin)
 {
     r.c.x += margin;
-    r.d.w = std::max(0, r.d.w - margin);
+    r.d.w = std::max(S(0), S(r.d.w - margin));
     return r;
 }
 
-inline rect_t rmargin(rect_t r, int2d_t margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rmargin(basic_rect_t<S> r, scalar_arg_t<S> margin)
 {
-    r.d.w = std::max(0, r.d.w - margin);
+    r.d.w = std::max(S(0), S(r.d.w - margin));
     return r;
 }
 
-inline rect_t umargin(rect_t r, int2d_t margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> umargin(basic_rect_t<S> r, scalar_arg_t<S> margin)
 {
     r.c.y += margin;
-    r.d.h = std::max(0, r.d.h - margin);
+    r.d.h = std::max(S(0), S(r.d.h - margin));
     return r;
 }
 
-inline rect_t dmargin(rect_t r, int2d_t margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> dmargin(basic_rect_t<S> r, scalar_arg_t<S> margin)
 {
-    r.d.h = std::max(0, r.d.h - margin);
+    r.d.h = std::max(S(0), S(r.d.h - margin));
     return r;
 }
 
-inline rect_t rect_margin(rect_t r, 
-                          int2d_t left, int2d_t top, int2d_t right, int2d_t bottom)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rect_margin(basic_rect_t<S> r,
+                                      scalar_arg_t<S> left,
+                                      scalar_arg_t<S> top,
+                                      scalar_arg_t<S> right,
+                                      scalar_arg_t<S> bottom)
 {
     r.c.x += left;
     r.c.y += top;
-    r.d.w = std::max(0, r.d.w - left - right);
-    r.d.h = std::max(0, r.d.h - top - bottom);
+    r.d.w = std::max(S(0), S(r.d.w - left - right));
+    r.d.h = std::max(S(0), S(r.d.h - top - bottom));
     return r;
 }
 
-inline rect_t rect_margin(rect_t r, int2d_t margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rect_margin(basic_rect_t<S> r,
+                                      scalar_arg_t<S> margin)
 {
     return rect_margin(r, margin, margin, margin, margin);
 }
 
-inline rect_t rect_margin(rect_t r, int2d_t x_margin, int2d_t y_margin)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rect_margin(basic_rect_t<S> r,
+                                      scalar_arg_t<S> x_margin,
+                                      scalar_arg_t<S> y_margin)
 {
     return rect_margin(r, x_margin, y_margin, x_margin, y_margin);
 }
 
-constexpr rect_t lpanel(rect_t r, int2d_t w)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> lpanel(basic_rect_t<S> r, scalar_arg_t<S> w)
 {
     return {{ r.c.x, r.c.y }, { w, r.d.h }};
 }
 
-constexpr rect_t rpanel(rect_t r, int2d_t w) 
-{ 
-    return {{ r.c.x + r.d.w - w, r.c.y }, { w, r.d.h }};
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> rpanel(basic_rect_t<S> r, scalar_arg_t<S> w)
+{
+    return {{ S(r.c.x + r.d.w - w), r.c.y }, { w, r.d.h }};
 }
 
-constexpr rect_t upanel(rect_t r, int2d_t h)
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> upanel(basic_rect_t<S> r, scalar_arg_t<S> h)
 {
     return {{ r.c.x, r.c.y }, { r.d.w, h }};
 }
 
-constexpr rect_t dpanel(rect_t r, int2d_t h) 
-{ 
-    return {{ r.c.x, r.c.y + r.d.h - h }, { r.d.w, h }};
+template<typename S = int2d_t>
+constexpr basic_rect_t<S> dpanel(basic_rect_t<S> r, scalar_arg_t<S> h)
+{
+    return {{ r.c.x, S(r.c.y + r.d.h - h) }, { r.d.w, h }};
 }
 
-class rect_iterator
-: public std::iterator<std::forward_iterator_tag, coord_t const>
+template<typename S>
+class basic_rect_range;
+
+template<typename S>
+class basic_rect_edge_range;
+
+template<typename S>
+class basic_rect_iterator
+: public std::iterator<std::forward_iterator_tag, basic_coord_t<S> const>
 {
-    friend class rect_range;
+    friend class basic_rect_range<S>;
 public:
-    rect_iterator() = default;
+    using coord_type = basic_coord_t<S>;
+    using rect_type = basic_rect_t<S>;
 
-    coord_t operator*() const { return m_current; }
-    coord_t const* operator->() const { return &m_current; }
+    basic_rect_iterator() = default;
 
-    rect_iterator& operator++()
+    coord_type operator*() const { return m_current; }
+    coord_type const* operator->() const { return &m_current; }
+
+    basic_rect_iterator& operator++()
     {
         if(++m_current.x == m_rect.ex())
         {
@@ -360,56 +454,64 @@ public:
         return *this;
     }
 
-    rect_iterator operator++(int2d_t)
+    basic_rect_iterator operator++(int)
     {
-        rect_iterator ret = *this;
+        basic_rect_iterator ret = *this;
         ++(*this);
         return ret;
     }
 
-    rect_t rect() const { return m_rect; }
+    rect_type rect() const { return m_rect; }
 private:
     struct begin_tag {};
     struct end_tag {};
 
-    rect_iterator(rect_t r, begin_tag)
+    basic_rect_iterator(rect_type r, begin_tag)
     : m_rect(r)
     , m_current(r.c)
     {}
 
-    rect_iterator(rect_t r, end_tag)
+    basic_rect_iterator(rect_type r, end_tag)
     : m_rect(r)
     , m_current{ r.c.x, r.ey() }
     {}
 
-    rect_t m_rect;
-    coord_t m_current;
+    rect_type m_rect;
+    coord_type m_current;
 };
 
-inline bool operator==(rect_iterator lhs, rect_iterator rhs)
+using rect_iterator = basic_rect_iterator<int2d_t>;
+
+template<typename S>
+bool operator==(basic_rect_iterator<S> lhs, basic_rect_iterator<S> rhs)
 {
     assert(lhs.rect() == rhs.rect());
     return *lhs == *rhs;
 }
 
-inline bool operator!=(rect_iterator lhs, rect_iterator rhs)
+template<typename S>
+bool operator!=(basic_rect_iterator<S> lhs, basic_rect_iterator<S> rhs)
 {
     assert(lhs.rect() == rhs.rect());
     return !(lhs == rhs);
 }
 
 
-class rect_edge_iterator
-: public std::iterator<std::forward_iterator_tag, coord_t const>
+template<typename S>
+class basic_rect_edge_iterator
+: public std::iterator<std::forward_iterator_tag, basic_coord_t<S> const>
 {
-    friend class rect_edge_range;
+    friend class basic_rect_edge_range<S>;
 public:
-    rect_edge_iterator() = default;
+    using coord_type = basic_coord_t<S>;
+    using rect_type = basic_rect_t<S>;
 
-    coord_t operator*() const { return m_current; }
-    coord_t const* operator->() const { return &m_current; }
+    basic_rect_edge_iterator() = default;
 
-    rect_edge_iterator& operator++()
+    coord_type operator*() const { return m_current; }
+    coord_type const* operator->() const { return &m_current; }
+
+    basic_rect_edge_iterator& operator++()
     {
         switch(m_mode) {
         case 0:
@@ -446,44 +548,48 @@ public:
         return *this;
     }
 
-    rect_edge_iterator operator++(int2d_t)
+    basic_rect_edge_iterator operator++(int)
     {
-        rect_edge_iterator ret = *this;
+        basic_rect_edge_iterator ret = *this;
         ++(*this);
         return ret;
     }
 
-    rect_t rect() const { return m_rect; }
+    rect_type rect() const { return m_rect; }
 private:
     struct begin_tag {};
     struct end_tag {};
 
-    rect_edge_iterator(rect_t r, begin_tag)
+    basic_rect_edge_iterator(rect_type r, begin_tag)
     : m_rect(r)
     , m_current(r.c)
     , m_mode(0)
     {}
 
-    rect_edge_iterator(rect_t r, end_tag)
+    basic_rect_edge_iterator(rect_type r, end_tag)
     : m_rect(r)
-    , m_current{ r.c.x - 1, r.c.y + 1 }
+    , m_current{ S(r.c.x - 1), S(r.c.y + 1) }
     , m_mode(4)
     {}
 
-    rect_t m_rect;
-    coord_t m_current;
+    rect_type m_rect;
+    coord_type m_current;
     int2d_t m_mode;
 };
 
-inline bool operator==(rect_edge_iterator lhs,
-                       rect_edge_iterator rhs)
+using rect_edge_iterator = basic_rect_edge_iterator<int2d_t>;
+
+template<typename S>
+bool operator==(basic_rect_edge_iterator<S> lhs,
+                basic_rect_edge_iterator<S> rhs)
 {
     assert(lhs.rect() == rhs.rect());
     return *lhs == *rhs;
 }
 
-inline bool operator!=(rect_edge_iterator lhs,
-                       rect_edge_iterator rhs)
+template<typename S>
+bool operator!=(basic_rect_edge_iterator<S> lhs,
+                basic_rect_edge_iterator<S> rhs)
 {
     return !(lhs == rhs);
 }
@@ -525,16 +631,19 @@ constexpr std::array<coord_t, 4> adjacent_range<4> =
     {  0,  1 },
 }};
 
-class adjacent_iterator
-: public std::iterator<std::forward_iterator_tag, coord_t const>
+template<typename S>
+class basic_adjacent_iterator
+: public std::iterator<std::forward_iterator_tag, basic_coord_t<S> const>
 {
 public:
-    adjacent_iterator() = default;
+    using coord_type = basic_coord_t<S>;
 
-    coord_t operator*() const { return m_current; }
-    coord_t const* operator->() const { return &m_current; }
+    basic_adjacent_iterator() = default;
 
-    adjacent_iterator& operator++()
+    coord_type operator*() const { return m_current; }
+    coord_type const* operator->() const { return &m_current; }
+
+    basic_adjacent_iterator& operator++()
     {
         ++m_current.x;
         if(m_current.x > m_center.x + 1)
@@ -547,104 +656,124 @@ public:
         return *this;
     }
 
-    adjacent_iterator operator++(int2d_t)
+    basic_adjacent_iterator operator++(int)
     {
-        adjacent_iterator ret = *this;
+        basic_adjacent_iterator ret = *this;
         ++(*this);
         return ret;
     }
 
-    coord_t center() const { return m_center; }
+    coord_type center() const { return m_center; }
 private:
     struct begin_tag {};
     struct end_tag {};
 
-    adjacent_iterator(coord_t center, begin_tag)
-    : m_current(center + coord_t{ -1, -1 })
+    basic_adjacent_iterator(coord_type center, begin_tag)
+    : m_current(center + coord_type{ -1, -1 })
     , m_center(center)
     {}
 
-    adjacent_iterator(coord_t center, end_tag)
-    : m_current(center + coord_t{ -1, 2 })
+    basic_adjacent_iterator(coord_type center, end_tag)
+    : m_current(center + coord_type{ -1, 2 })
     , m_center(center)
     {}
 
-    coord_t m_current;
-    coord_t m_center;
+    coord_type m_current;
+    coord_type m_center;
 };
 
-inline bool operator==(adjacent_iterator lhs, adjacent_iterator rhs)
+using adjacent_iterator = basic_adjacent_iterator<int2d_t>;
+
+template<typename S>
+bool operator==(basic_adjacent_iterator<S> lhs,
+                basic_adjacent_iterator<S> rhs)
 {
     return *lhs == *rhs;
 }
 
-inline bool operator!=(adjacent_iterator lhs, adjacent_iterator rhs)
+template<typename S>
+bool operator!=(basic_adjacent_iterator<S> lhs,
+                basic_adjacent_iterator<S> rhs)
 {
     return *lhs != *rhs;
 }
 
-class rect_range
+template<typename S>
+class basic_rect_range
 {
 public:
-    using const_iterator = rect_iterator;
+    using const_iterator = basic_rect_iterator<S>;
+    using rect_type = basic_rect_t<S>;
 
-    rect_range() : rect_range(rect_t{}) {}
-    rect_range(rect_t r)
+    basic_rect_range() : basic_rect_range(rect_type{}) {}
+    // Counts every cell of 'r' as visited up front, rather than per step.
+    basic_rect_range(rect_type r)
     {
         if(area(r) == 0)
             r = {};
-        m_begin = rect_iterator(r, rect_iterator::begin_tag());
-        m_end = rect_iterator(r, rect_iterator::end_tag());
+        INT2D_COUNT(cells_visited, area(r));
+        m_begin = const_iterator(r, typename const_iterator::begin_tag());
+        m_end = const_iterator(r, typename const_iterator::end_tag());
     }
 
-    rect_iterator begin() const { return m_begin; }
-    rect_iterator end() const { return m_end; }
+    const_iterator begin() const { return m_begin; }
+    const_iterator end() const { return m_end; }
 
-    rect_iterator cbegin() const { return begin(); }
-    rect_iterator cend() const { return end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
 
-    rect_t rect() const { return m_begin.rect(); }
+    rect_type rect() const { return m_begin.rect(); }
 private:
-    rect_iterator m_begin;
-    rect_iterator m_end;
+    const_iterator m_begin;
+    const_iterator m_end;
 };
 
-inline rect_range dimen_range(dimen_t dim)
+using rect_range = basic_rect_range<int2d_t>;
+
+template<typename S = int2d_t>
+basic_rect_range<S> dimen_range(basic_dimen_t<S> dim)
 {
-    return rect_range(to_rect(dim));
+    return basic_rect_range<S>(to_rect(dim));
 }
 
-inline rect_range circular_range(coord_t crd, int2d_t rad)
+template<typename S = int2d_t>
+basic_rect_range<S> circular_range(basic_coord_t<S> crd, scalar_arg_t<S> rad)
 {
-    return rect_range(rect_from_radius(crd, rad));
+    return basic_rect_range<S>(rect_from_radius(crd, rad));
 }
 
-class rect_edge_range
+template<typename S>
+class basic_rect_edge_range
 {
 public:
-    using const_iterator = rect_edge_iterator;
+    using const_iterator = basic_rect_edge_iterator<S>;
+    using rect_type = basic_rect_t<S>;
 
-    rect_edge_range() : rect_edge_range(rect_t{}) {}
-    rect_edge_range(rect_t r)
-    : m_begin(r, rect_edge_iterator::begin_tag())
-    , m_end(r, rect_edge_iterator::end_tag())
+    basic_rect_edge_range() : basic_rect_edge_range(rect_type{}) {}
+    basic_rect_edge_range(rect_type r)
+    : m_begin(r, typename const_iterator::begin_tag())
+    , m_end(r, typename const_iterator::end_tag())
     {}
 
-    rect_edge_iterator begin() const { return m_begin; }
-    rect_edge_iterator end() const { return m_end; }
+    const_iterator begin() const { return m_begin; }
+    const_iterator end() const { return m_end; }
 
-    rect_edge_iterator cbegin() const { return begin(); }
-    rect_edge_iterator cend() const { return cend(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
 
-    rect_t rect() const { return m_begin.rect(); }
+    rect_type rect() const { return m_begin.rect(); }
 private:
-    rect_edge_iterator m_begin;
-    rect_edge_iterator m_end;
+    const_iterator m_begin;
+    const_iterator m_end;
 };
 
-inline rect_edge_range radius_range(coord_t center, int2d_t rad)
+using rect_edge_range = basic_rect_edge_range<int2d_t>;
+
+template<typename S = int2d_t>
+basic_rect_edge_range<S> radius_range(basic_coord_t<S> center,
+                                      scalar_arg_t<S> rad)
 {
-    return rect_edge_range(rect_from_radius(center, rad));
+    return basic_rect_edge_range<S>(rect_from_radius(center, rad));
 }
 
 } // namespace i2d
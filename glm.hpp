@@ -15,22 +15,26 @@ T from_vec2(glm::vec2 v)
     return T{ v.x, v.y };
 }
 
-inline glm::vec2 to_vec2(coord_t c)
+template<typename S>
+glm::vec2 to_vec2(basic_coord_t<S> c)
 {
     return ::glm::vec2(c.x, c.y);
 }
 
-inline glm::vec2 to_vec2(dimen_t d)
+template<typename S>
+glm::vec2 to_vec2(basic_dimen_t<S> d)
 {
     return ::glm::vec2(d.w, d.h);
 }
 
-inline ::glm::vec3 to_vec3(coord_t c, float z = 0.0f)
+template<typename S>
+::glm::vec3 to_vec3(basic_coord_t<S> c, float z = 0.0f)
 {
     return ::glm::vec3(c.x, c.y, z);
 }
 
-inline ::glm::vec3 to_vec3(dimen_t d, float z = 0.0f)
+template<typename S>
+::glm::vec3 to_vec3(basic_dimen_t<S> d, float z = 0.0f)
 {
     return ::glm::vec3(d.w, d.h, z);
 }
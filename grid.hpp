@@ -6,10 +6,15 @@
 #include <cassert>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "geometry.hpp"
+#include "instrument.hpp"
 
 namespace i2d {
 
@@ -19,14 +24,103 @@ namespace impl {
 
     template<typename T>
     using ToVoid = typename to_void<T>::type;
+
+    // An allocator adaptor that leaves trivially default constructible
+    // types uninitialized when constructing them without arguments.
+    // grid_t uses this and value-initializes cells itself, unless asked
+    // not to.
+    template<class A>
+    class default_init_allocator : public A
+    {
+        using traits = std::allocator_traits<A>;
+    public:
+        template<typename U>
+        struct rebind
+        {
+            using other = default_init_allocator<
+                typename traits::template rebind_alloc<U> >;
+        };
+
+        using A::A;
+
+        default_init_allocator(A const& alloc) noexcept : A(alloc) {}
+
+        template<typename U>
+        typename std::enable_if<
+            std::is_trivially_default_constructible<U>::value>::type
+        construct(U* ptr)
+        {
+            ::new(static_cast<void*>(ptr)) U;
+        }
+
+        template<typename U, typename... Args>
+        typename std::enable_if<
+            sizeof...(Args) != 0
+            || !std::is_trivially_default_constructible<U>::value>::type
+        construct(U* ptr, Args&&... args)
+        {
+            traits::construct(static_cast<A&>(*this), ptr,
+                              std::forward<Args>(args)...);
+        }
+    };
+
+    template<class A>
+    bool operator==(default_init_allocator<A> const& lhs,
+                    default_init_allocator<A> const& rhs)
+    {
+        return static_cast<A const&>(lhs) == static_cast<A const&>(rhs);
+    }
+
+    template<class A>
+    bool operator!=(default_init_allocator<A> const& lhs,
+                    default_init_allocator<A> const& rhs)
+    {
+        return !(lhs == rhs);
+    }
 }
 
+// Pass this to grid_t to leave the cells of trivially default
+// constructible types uninitialized, rather than zeroing them.
+// Other types are value-initialized regardless.
+struct uninitialized_t { explicit uninitialized_t() = default; };
+constexpr uninitialized_t uninitialized{};
+
+// Pass this and a function object 'gen' to fixed_grid_t to set cell 'i'
+// to 'gen(i)'. With a constexpr 'gen' the grid is a constant expression.
+struct generated_t { explicit generated_t() = default; };
+constexpr generated_t generated{};
+
 
-constexpr std::size_t grid_index(dimen_t d, coord_t c)
-    { return c.y * d.w + c.x; }
+template<typename S = int2d_t>
+constexpr std::size_t grid_index(basic_dimen_t<S> d, basic_coord_t<S> c)
+    { return std::size_t(c.y) * std::size_t(d.w) + std::size_t(c.x); }
+
+template<typename S = int2d_t>
+constexpr basic_coord_t<S> from_grid_index(basic_dimen_t<S> d,
+                                           std::size_t i)
+    { return { S(i % std::size_t(d.w)), S(i / std::size_t(d.w)) }; }
+
+namespace impl
+{
+    // Grids are sized in int2d_t, so coords of another scalar are checked
+    // and indexed in whichever of the two is wider.
+    template<typename S>
+    using grid_scalar_t = std::common_type_t<S, int2d_t>;
+
+    template<typename S>
+    constexpr bool grid_in_bounds(dimen_t d, basic_coord_t<S> c)
+    {
+        return in_bounds(coord_cast<grid_scalar_t<S>>(c),
+                         dimen_cast<grid_scalar_t<S>>(d));
+    }
 
-constexpr coord_t from_grid_index(dimen_t d, int i)
-    { return { i % d.w, i / d.w }; }
+    template<typename S>
+    constexpr std::size_t grid_coord_index(dimen_t d, basic_coord_t<S> c)
+    {
+        return grid_index(dimen_cast<grid_scalar_t<S>>(d),
+                          coord_cast<grid_scalar_t<S>>(c));
+    }
+} // namespace impl
 
 template<typename T, typename = void>
 struct is_grid : std::false_type {};
@@ -52,6 +146,11 @@ public:
             t = value;
     }
 
+    template<typename Gen>
+    constexpr fixed_grid_t(generated_t, Gen gen)
+    : fixed_grid_t(gen, std::make_index_sequence<Width*Height>())
+    {}
+
     fixed_grid_t(fixed_grid_t const&) = default;
     fixed_grid_t(fixed_grid_t&&) = default;
 
@@ -69,16 +168,18 @@ public:
 
     constexpr dimen_t dimen() const { return { Width, Height }; }
 
-    T const& at(coord_t c) const 
+    template<typename S = int2d_t>
+    T const& at(basic_coord_t<S> c) const
     {
-        if(!in_bounds(c, dimen()))
+        if(!impl::grid_in_bounds(dimen(), c))
             throw std::out_of_range("grid_t::at");
         return m_arr[index(c)];
     }
 
-    T& at(coord_t c)
+    template<typename S = int2d_t>
+    T& at(basic_coord_t<S> c)
     {
-        if(!in_bounds(c, dimen()))
+        if(!impl::grid_in_bounds(dimen(), c))
             throw std::out_of_range("grid_t::at");
         return m_arr[index(c)];
     }
@@ -86,22 +187,33 @@ public:
     T const& at(unsigned i) const { return m_arr.at(i); }
     T& at(unsigned i) { return m_arr.at(i); }
 
-    T const& operator[](coord_t c) const { return m_arr[index(c)]; }
-    T& operator[](coord_t c) { return m_arr[index(c)]; }
+    template<typename S = int2d_t>
+    constexpr T const& operator[](basic_coord_t<S> c) const
+        { return m_arr[index(c)]; }
+    template<typename S = int2d_t>
+    T& operator[](basic_coord_t<S> c) { return m_arr[index(c)]; }
 
-    T const& operator[](unsigned i) const { return m_arr[i]; }
+    constexpr T const& operator[](unsigned i) const { return m_arr[i]; }
     T& operator[](unsigned i) { return m_arr[i]; }
 
     T const* data() const { return m_arr.data(); }
     T* data() { return m_arr.data(); }
 
-    std::size_t size() const { return m_arr.size(); }
+    constexpr std::size_t size() const { return m_arr.size(); }
 
     void fill(T const& t) { m_arr.fill(t); }
 
-    std::size_t index(coord_t c) const { return grid_index(dimen(), c); }
+    template<typename S = int2d_t>
+    constexpr std::size_t index(basic_coord_t<S> c) const
+        { return impl::grid_coord_index(dimen(), c); }
     coord_t from_index(unsigned i) const { return from_grid_index(dimen(), i); }
 private:
+    template<typename Gen, std::size_t... I>
+    constexpr fixed_grid_t(Gen gen, std::index_sequence<I...>)
+    : m_arr{{ gen(I)... }}
+    {
+        (void)gen; // Unused when the grid is empty.
+    }
 
     array_type m_arr;
 };
@@ -112,7 +224,7 @@ template<typename T, class A = std::allocator<T> >
 class grid_t
 {
 private:
-    using vector_type = std::vector<T, A>;
+    using vector_type = std::vector<T, impl::default_init_allocator<A> >;
 public:
     using is_grid = void;
     using value_type = T;
@@ -132,16 +244,38 @@ public:
     explicit grid_t(dimen_t dim, A const& alloc = A())
     : m_vec(area(dim), alloc)
     , m_dim(dim)
-    {}
+    {
+        INT2D_COUNT(bytes_allocated, size() * sizeof(T));
+        value_init(0);
+    }
+
+    grid_t(dimen_t dim, uninitialized_t, A const& alloc = A())
+    : m_vec(area(dim), alloc)
+    , m_dim(dim)
+    {
+        INT2D_COUNT(bytes_allocated, size() * sizeof(T));
+    }
 
     grid_t(dimen_t dim, T const& t, A const& alloc = A())
     : m_vec(area(dim), t, alloc)
     , m_dim(dim)
-    {}
+    {
+        INT2D_COUNT(bytes_allocated, size() * sizeof(T));
+    }
 
     grid_t(grid_t const&) = default;
     grid_t(grid_t&&) = default;
 
+    grid_t(grid_t const& other, A const& alloc)
+    : m_vec(other.m_vec, alloc)
+    , m_dim(other.m_dim)
+    {}
+
+    grid_t(grid_t&& other, A const& alloc)
+    : m_vec(std::move(other.m_vec), alloc)
+    , m_dim(other.m_dim)
+    {}
+
     grid_t& operator=(grid_t const&) = default;
     grid_t& operator=(grid_t&&) = default;
 
@@ -170,16 +304,18 @@ public:
 
     dimen_t dimen() const { return m_dim; }
 
-    T const& at(coord_t c) const
+    template<typename S = int2d_t>
+    T const& at(basic_coord_t<S> c) const
     {
-        if(!in_bounds(c, dimen()))
+        if(!impl::grid_in_bounds(dimen(), c))
             throw std::out_of_range("grid_t::at");
         return m_vec[index(c)];
     }
 
-    T& at(coord_t c)
+    template<typename S = int2d_t>
+    T& at(basic_coord_t<S> c)
     {
-        if(!in_bounds(c, dimen()))
+        if(!impl::grid_in_bounds(dimen(), c))
             throw std::out_of_range("grid_t::at");
         return m_vec[index(c)];
     }
@@ -187,13 +323,16 @@ public:
     T const& at(unsigned i) const { return m_vec.at(i); }
     T& at(unsigned i) { return m_vec.at(i); }
 
-    T get(coord_t c, T const& default_) const
+    template<typename S = int2d_t>
+    T get(basic_coord_t<S> c, T const& default_) const
     {
-        return in_bounds(c, dimen()) ? m_vec[index(c)] : default_;
+        return impl::grid_in_bounds(dimen(), c) ? m_vec[index(c)] : default_;
     }
 
-    T const& operator[](coord_t c) const { return m_vec[index(c)]; }
-    T& operator[](coord_t c) { return m_vec[index(c)]; }
+    template<typename S = int2d_t>
+    T const& operator[](basic_coord_t<S> c) const { return m_vec[index(c)]; }
+    template<typename S = int2d_t>
+    T& operator[](basic_coord_t<S> c) { return m_vec[index(c)]; }
 
     T const& operator[](unsigned i) const { return m_vec[i]; }
     T& operator[](unsigned i) { return m_vec[i]; }
@@ -203,15 +342,43 @@ public:
 
     std::size_t size() const { return m_vec.size(); }
 
+    // Cells that are kept keep their coordinates.
+    // New cells are value-initialized.
     void resize(dimen_t new_dim)
     {
-        grid_t new_grid(new_dim);
+        INT2D_COUNT(resizes, 1);
+        grid_t new_grid(new_dim, uninitialized, get_allocator());
         dimen_t const copy_dim = crop(dimen(), new_dim);
-        for(auto crd : dimen_range(copy_dim))
-            new_grid[crd] = std::move(operator[](crd));
+        move_rows_to(new_grid, copy_dim);
+        for(int2d_t y = 0; y < copy_dim.h; ++y)
+            new_grid.value_init(y * new_dim.w + copy_dim.w,
+                                (y + 1) * new_dim.w);
+        new_grid.value_init(copy_dim.h * new_dim.w);
         swap(new_grid);
     }
 
+    // Like the above, but new cells are left uninitialized
+    // (see 'uninitialized_t').
+    void resize(dimen_t new_dim, uninitialized_t)
+    {
+        INT2D_COUNT(resizes, 1);
+        grid_t new_grid(new_dim, uninitialized, get_allocator());
+        move_rows_to(new_grid, crop(dimen(), new_dim));
+        swap(new_grid);
+    }
+
+    // Replaces the contents with 'area(dim)' uninitialized cells
+    // (see 'uninitialized_t'). Existing capacity is reused.
+    void assign_uninitialized(dimen_t dim)
+    {
+        std::size_t const n = area(dim);
+        if(n > m_vec.capacity())
+            INT2D_COUNT(bytes_allocated, n * sizeof(T));
+        m_vec.clear();
+        m_vec.resize(n);
+        m_dim = dim;
+    }
+
     void clear()
     {
         m_vec.clear();
@@ -223,9 +390,36 @@ public:
         m_vec.assign(m_vec.size(), t);
     }
 
-    std::size_t index(coord_t c) const { return c.y * m_dim.w + c.x; }
+    template<typename S = int2d_t>
+    std::size_t index(basic_coord_t<S> c) const
+        { return impl::grid_coord_index(m_dim, c); }
     coord_t from_index(unsigned i) const { return from_grid_index(dimen(), i); }
 private:
+    // Value-initializes cells [begin, end).
+    // Only trivial types need this; the allocator handles the rest.
+    void value_init(std::size_t begin, std::size_t end)
+    {
+        value_init(begin, end, std::is_trivially_default_constructible<T>());
+    }
+
+    void value_init(std::size_t begin, std::size_t end, std::true_type)
+    {
+        std::fill(m_vec.begin() + begin, m_vec.begin() + end, T());
+    }
+
+    void value_init(std::size_t, std::size_t, std::false_type) {}
+
+    void value_init(std::size_t begin) { value_init(begin, m_vec.size()); }
+
+    void move_rows_to(grid_t& dest, dimen_t copy_dim)
+    {
+        for(int2d_t y = 0; y < copy_dim.h; ++y)
+        {
+            auto const from = m_vec.begin() + y * m_dim.w;
+            std::move(from, from + copy_dim.w,
+                      dest.m_vec.begin() + y * dest.m_dim.w);
+        }
+    }
 
     vector_type m_vec;
     dimen_t m_dim;
@@ -242,8 +436,10 @@ void fblit(Grid& dest,
            Func merge_func = Func())
 {
     static_assert(is_grid<Grid>::value, "must be a Grid");
-    ASSERT(in_bounds(src_rect_t, src.to_rect_t()));
-    ASSERT(in_bounds(src_rect_t, dest.to_rect_t()));
+    assert(in_bounds(src_rect_t, src.dimen()));
+    assert(in_bounds(rect_t{ dest_crd, src_rect_t.d }, dest.dimen()));
+    INT2D_COUNT(blits, 1);
+    INT2D_COUNT(cells_visited, area(src_rect_t));
     for(int2d_t y = 0; y < src_rect_t.d.h; ++y)
     for(int2d_t x = 0; x < src_rect_t.d.w; ++x)
     {
@@ -280,7 +476,7 @@ void fblit(Grid& dest,
            Func merge_func = Func())
 {
     static_assert(is_grid<Grid>::value, "must be a Grid");
-    fblit(dest, dest_crd, src, src.to_rect_t(), merge_func);
+    fblit(dest, dest_crd, src, to_rect(src.dimen()), merge_func);
 }
 
 template<typename Grid>
@@ -288,7 +484,7 @@ void blit(Grid& dest,
           coord_t dest_crd,
           Grid const& src)
 {
-    blit(dest, dest_crd, src, src.to_rect_t());
+    blit(dest, dest_crd, src, to_rect(src.dimen()));
 }
 
 namespace impl
@@ -328,6 +524,104 @@ inline grid_t<char> string_to_grid(std::string str)
     return ret;
 }
 
+namespace impl
+{
+    template<int2d_t Height>
+    struct literal_lines_t
+    {
+        std::size_t start[Height];
+        std::size_t length[Height];
+    };
+
+    // Throws if 'str' has more than 'Height' lines, which also stops it
+    // from compiling as a constant expression.
+    template<int2d_t Height, std::size_t N>
+    constexpr literal_lines_t<Height> literal_lines(char const (&str)[N])
+    {
+        literal_lines_t<Height> ret = {};
+        std::size_t y = 0;
+        for(std::size_t i = 0; i + 1 < N; ++i)
+        {
+            if(str[i] == '\n')
+            {
+                if(y + 1 >= std::size_t(Height))
+                    throw std::length_error("literal_lines: too many lines");
+                ret.length[y] = i - ret.start[y];
+                ret.start[++y] = i + 1;
+            }
+        }
+        ret.length[y] = N - 1 - ret.start[y];
+        return ret;
+    }
+
+    struct literal_char_t
+    {
+        constexpr char operator()(char ch) const { return ch; }
+    };
+
+    // Generates the cells of a fixed_grid_t from a string literal.
+    template<int2d_t Width, int2d_t Height, typename Map>
+    struct literal_cells_t
+    {
+        char const* str;
+        literal_lines_t<Height> lines;
+        Map map;
+
+        constexpr auto operator()(std::size_t i) const
+        {
+            std::size_t const x = i % Width;
+            std::size_t const y = i / Width;
+            return map(x < lines.length[y] ? str[lines.start[y] + x] : '\0');
+        }
+    };
+} // namespace impl
+
+// The dimensions 'string_to_grid' gives the string literal 'str'.
+template<std::size_t N>
+constexpr dimen_t literal_grid_dimen(char const (&str)[N])
+{
+    dimen_t dim = { 0, 1 };
+    int2d_t w = 0;
+    for(std::size_t i = 0; i + 1 < N; ++i)
+    {
+        if(str[i] == '\n')
+        {
+            w = 0;
+            ++dim.h;
+        }
+        else
+            dim.w = std::max(dim.w, ++w);
+    }
+    return dim;
+}
+
+// Like 'string_to_grid', but for a string literal and at compile time.
+// Each cell is 'map(ch)', so 'map' can convert characters to tiles and
+// must be a constexpr function or function object for the result to be
+// a constant expression. 'Width' and 'Height' must match
+// 'literal_grid_dimen(str)'; the macros below fill them in.
+template<int2d_t Width, int2d_t Height, std::size_t N,
+         typename Map = impl::literal_char_t>
+constexpr auto literal_to_grid(char const (&str)[N], Map map = Map())
+{
+    using cell_type = std::decay_t<decltype(map('\0'))>;
+    assert((literal_grid_dimen(str) == dimen_t{ Width, Height }));
+    return fixed_grid_t<cell_type, Width, Height>(
+        generated,
+        impl::literal_cells_t<Width, Height, Map>{
+            str, impl::literal_lines<Height>(str), map });
+}
+
+// Evaluates to 'literal_to_grid(str)' with its dimensions deduced, e.g.
+//   constexpr auto room = INT2D_LITERAL_GRID("#####\n#...#\n#####");
+#define INT2D_LITERAL_GRID(str) \
+    (::i2d::literal_to_grid<::i2d::literal_grid_dimen(str).w, \
+                            ::i2d::literal_grid_dimen(str).h>(str))
+
+#define INT2D_LITERAL_GRID_MAP(str, map) \
+    (::i2d::literal_to_grid<::i2d::literal_grid_dimen(str).w, \
+                            ::i2d::literal_grid_dimen(str).h>(str, map))
+
 } // namespace i2d
 
 #endif
@@ -0,0 +1,529 @@
+#ifndef INT2D_HPA_HPP
+#define INT2D_HPA_HPP
+
+// Hierarchical pathfinding (HPA*) over 8-connected grids.
+//
+// The map is divided into square clusters. Passable openings along the
+// borders between clusters become abstract nodes, and the distances
+// between the nodes of each cluster are cached. Queries search this small
+// abstract graph first and then refine each abstract step with a search
+// confined to a single cluster.
+//
+// Movement is 8-way. Diagonal steps may not cut corners: both cells
+// orthogonally adjacent to the step must be passable.
+// Costs are integers: 'hpa_orth_cost' per orthogonal step and
+// 'hpa_diag_cost' per diagonal step.
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+constexpr int hpa_orth_cost = 10;
+constexpr int hpa_diag_cost = 14;
+
+namespace impl
+{
+    inline int octile_dist(coord_t a, coord_t b)
+    {
+        int const dx = std::abs(a.x - b.x);
+        int const dy = std::abs(a.y - b.y);
+        return (hpa_orth_cost * std::max(dx, dy)
+                + (hpa_diag_cost - hpa_orth_cost) * std::min(dx, dy));
+    }
+
+    // A* (or Dijkstra, if 'goal' is null) confined to 'bounds'.
+    // 'dist' is filled with the cost to reach each cell of 'bounds',
+    // in row-major order, or INT_MAX if it wasn't reached.
+    // If 'goal' is given the search stops once it is reached and
+    // 'path' (if not null) receives the path from 'from' to '*goal'.
+    // Returns the cost to reach 'goal', or -1.
+    template<typename Passable>
+    int bounded_search(Passable const& passable, rect_t bounds,
+                       coord_t from, coord_t const* goal,
+                       std::vector<int>& dist,
+                       std::vector<coord_t>* path = nullptr)
+    {
+        assert(in_bounds(from, bounds));
+        auto const index = [&](coord_t c)
+        {
+            return grid_index(bounds.d, c - bounds.c);
+        };
+        auto const h = [&](coord_t c)
+        {
+            return goal ? octile_dist(c, *goal) : 0;
+        };
+
+        dist.assign(area(bounds), INT_MAX);
+        std::vector<int> parent(path ? area(bounds) : 0, -1);
+
+        using entry_t = std::pair<int, int>; // f, index
+        std::priority_queue<entry_t, std::vector<entry_t>,
+                            std::greater<entry_t> > open;
+        dist[index(from)] = 0;
+        open.push({ h(from), static_cast<int>(index(from)) });
+
+        while(!open.empty())
+        {
+            entry_t const top = open.top();
+            open.pop();
+            coord_t const crd =
+                bounds.c + from_grid_index(bounds.d, top.second);
+            int const g = dist[top.second];
+            if(top.first != g + h(crd))
+                continue; // Stale entry.
+            if(goal && crd == *goal)
+                break;
+
+            for(coord_t dir : dir_range)
+            {
+                coord_t const next = crd + dir;
+                if(!in_bounds(next, bounds) || !passable(next))
+                    continue;
+                bool const diagonal = dir.x && dir.y;
+                if(diagonal && (!passable(coord_t{ next.x, crd.y })
+                                || !passable(coord_t{ crd.x, next.y })))
+                    continue;
+                int const cost =
+                    g + (diagonal ? hpa_diag_cost : hpa_orth_cost);
+                std::size_t const i = index(next);
+                if(cost < dist[i])
+                {
+                    dist[i] = cost;
+                    if(path)
+                        parent[i] = top.second;
+                    open.push({ cost + h(next), static_cast<int>(i) });
+                }
+            }
+        }
+
+        if(!goal)
+            return -1;
+        int const cost = dist[index(*goal)];
+        if(cost == INT_MAX)
+            return -1;
+        if(path)
+        {
+            std::size_t const begin = path->size();
+            for(int i = index(*goal); i != -1; i = parent[i])
+                path->push_back(bounds.c + from_grid_index(bounds.d, i));
+            std::reverse(path->begin() + begin, path->end());
+        }
+        return cost;
+    }
+} // namespace impl
+
+// 'Passable' is a function object with the signature bool(coord_t),
+// only ever called with coords inside 'dimen()'. Call 'update' whenever
+// the cells it reports change.
+template<typename Passable>
+class hpa_pathfinder_t
+{
+public:
+    hpa_pathfinder_t(dimen_t dim, int2d_t cluster_size,
+                     Passable passable = Passable())
+    : m_dim(dim)
+    , m_cluster_size(cluster_size)
+    , m_clusters{ (dim.w + cluster_size - 1) / cluster_size,
+                  (dim.h + cluster_size - 1) / cluster_size }
+    , m_passable(std::move(passable))
+    {
+        assert(cluster_size > 0);
+        rebuild();
+    }
+
+    dimen_t dimen() const { return m_dim; }
+    int2d_t cluster_size() const { return m_cluster_size; }
+
+    // The number of clusters along each axis.
+    dimen_t clusters() const { return m_clusters; }
+
+    // The number of abstract nodes.
+    std::size_t node_count() const { return m_offsets.back(); }
+
+    // Recomputes everything.
+    void rebuild()
+    {
+        m_data.assign(area(m_clusters), cluster_t());
+        for(coord_t c : dimen_range(m_clusters))
+            m_data[cluster_index(c)].rect = cluster_rect(c);
+        m_offsets.assign(m_data.size() + 1, 0);
+        update(to_rect(m_dim));
+    }
+
+    // Recomputes only the clusters affected by cells within 'changed'.
+    void update(rect_t changed)
+    {
+        // Borders depend on cells on both sides, so the clusters one
+        // cell outside 'changed' are affected as well.
+        changed = crop(rect_margin(changed, -1), m_dim);
+        if(!changed)
+            return;
+        rect_t const touched = cluster_bounds(changed);
+
+        for(coord_t c : rect_range(touched))
+            scan_borders(c);
+
+        // Borders scanned above are shared with clusters to the east
+        // and south, so their nodes change too.
+        rect_t const rebuilt =
+            crop(rect_t{ touched.c, touched.d + dimen_t{ 1, 1 } },
+                 m_clusters);
+        for(coord_t c : rect_range(rebuilt))
+            build_nodes(c);
+
+        m_offsets.resize(m_data.size() + 1);
+        m_offsets[0] = 0;
+        for(std::size_t i = 0; i != m_data.size(); ++i)
+            m_offsets[i + 1] = m_offsets[i] + m_data[i].nodes.size();
+    }
+
+    // Returns the path from 'from' to 'to', inclusive,
+    // or an empty vector if there is none.
+    std::vector<coord_t> find_path(coord_t from, coord_t to) const
+    {
+        std::vector<coord_t> path;
+        if(!in_bounds(from, m_dim) || !in_bounds(to, m_dim)
+           || !m_passable(from) || !m_passable(to))
+            return path;
+        if(from == to)
+        {
+            path.push_back(from);
+            return path;
+        }
+
+        std::vector<int> const chain = abstract_search(from, to);
+        if(chain.empty())
+            return path;
+
+        std::vector<int> scratch;
+        path.push_back(from);
+        coord_t prev = from;
+        int prev_id = start_id();
+        for(std::size_t i = 1; i != chain.size(); ++i)
+        {
+            int const id = chain[i];
+            coord_t const pos = id == goal_id() ? to : node_pos(id);
+            bool const same_cluster = prev_id == start_id()
+                || id == goal_id()
+                || node_cluster(prev_id) == node_cluster(id);
+            if(same_cluster)
+            {
+                path.pop_back();
+                impl::bounded_search(m_passable, cluster_rect_of(prev),
+                                     prev, &pos, scratch, &path);
+            }
+            else
+                path.push_back(pos);
+            prev = pos;
+            prev_id = id;
+        }
+        return path;
+    }
+private:
+    struct node_t
+    {
+        coord_t pos;
+        std::vector<coord_t> links; // Nodes in adjacent clusters.
+    };
+
+    struct cluster_t
+    {
+        rect_t rect;
+        std::vector<node_t> nodes;
+        std::vector<int> dist; // [i * nodes.size() + j], or -1.
+
+        // Openings to the cluster to the east and south, as pairs of
+        // (cell in this cluster, cell in the other cluster).
+        std::vector<std::pair<coord_t, coord_t> > east;
+        std::vector<std::pair<coord_t, coord_t> > south;
+    };
+
+    std::size_t cluster_index(coord_t c) const
+    {
+        return grid_index(m_clusters, c);
+    }
+
+    coord_t cluster_of(coord_t crd) const
+    {
+        return { crd.x / m_cluster_size, crd.y / m_cluster_size };
+    }
+
+    rect_t cluster_rect(coord_t c) const
+    {
+        rect_t const r = { vec_mul(c, m_cluster_size),
+                           square_dimen(m_cluster_size) };
+        return crop(r, m_dim);
+    }
+
+    rect_t cluster_rect_of(coord_t crd) const
+    {
+        return m_data[cluster_index(cluster_of(crd))].rect;
+    }
+
+    // The clusters that overlap 'r'.
+    rect_t cluster_bounds(rect_t r) const
+    {
+        return rect_from_2_coords(cluster_of(r.c), cluster_of(r.r()));
+    }
+
+    // Finds the openings along one border. Long openings get a node at
+    // each end, short ones a single node in the middle.
+    void scan_border(coord_t first, coord_t step, coord_t across,
+                     int2d_t length,
+                     std::vector<std::pair<coord_t, coord_t> >& out) const
+    {
+        out.clear();
+        auto const add = [&](int2d_t begin, int2d_t end)
+        {
+            int2d_t constexpr long_opening = 6;
+            auto const push = [&](int2d_t i)
+            {
+                coord_t const a = first + vec_mul(step, i);
+                out.push_back({ a, a + across });
+            };
+            if(end - begin >= long_opening)
+            {
+                push(begin);
+                push(end - 1);
+            }
+            else
+                push((begin + end - 1) / 2);
+        };
+
+        int2d_t run = -1;
+        for(int2d_t i = 0; i < length; ++i)
+        {
+            coord_t const a = first + vec_mul(step, i);
+            bool const open = m_passable(a) && m_passable(a + across);
+            if(open && run < 0)
+                run = i;
+            else if(!open && run >= 0)
+            {
+                add(run, i);
+                run = -1;
+            }
+        }
+        if(run >= 0)
+            add(run, length);
+    }
+
+    void scan_borders(coord_t c)
+    {
+        cluster_t& cluster = m_data[cluster_index(c)];
+        rect_t const r = cluster.rect;
+        if(c.x + 1 < m_clusters.w)
+            scan_border(r.rxy(), { 0, 1 }, { 1, 0 }, r.d.h, cluster.east);
+        else
+            cluster.east.clear();
+        if(c.y + 1 < m_clusters.h)
+            scan_border(r.xry(), { 1, 0 }, { 0, 1 }, r.d.w, cluster.south);
+        else
+            cluster.south.clear();
+    }
+
+    void build_nodes(coord_t c)
+    {
+        cluster_t& cluster = m_data[cluster_index(c)];
+        cluster.nodes.clear();
+        auto const add = [&](coord_t pos, coord_t link)
+        {
+            for(node_t& node : cluster.nodes)
+            {
+                if(node.pos == pos)
+                {
+                    node.links.push_back(link);
+                    return;
+                }
+            }
+            cluster.nodes.push_back({ pos, { link } });
+        };
+
+        for(auto const& p : cluster.east)
+            add(p.first, p.second);
+        for(auto const& p : cluster.south)
+            add(p.first, p.second);
+        if(c.x > 0)
+            for(auto const& p : m_data[cluster_index(left1(c))].east)
+                add(p.second, p.first);
+        if(c.y > 0)
+            for(auto const& p : m_data[cluster_index(up1(c))].south)
+                add(p.second, p.first);
+
+        std::size_t const n = cluster.nodes.size();
+        cluster.dist.assign(n * n, -1);
+        std::vector<int> dist;
+        for(std::size_t i = 0; i != n; ++i)
+        {
+            impl::bounded_search(m_passable, cluster.rect,
+                                 cluster.nodes[i].pos, nullptr, dist);
+            for(std::size_t j = 0; j != n; ++j)
+            {
+                coord_t const p = cluster.nodes[j].pos - cluster.rect.c;
+                int const d = dist[grid_index(cluster.rect.d, p)];
+                cluster.dist[i * n + j] = d == INT_MAX ? -1 : d;
+            }
+        }
+    }
+
+    // Abstract node ids. Real nodes are numbered cluster by cluster.
+    int start_id() const { return static_cast<int>(node_count()); }
+    int goal_id() const { return start_id() + 1; }
+
+    std::size_t node_cluster(int id) const
+    {
+        auto const it = std::upper_bound(m_offsets.begin(), m_offsets.end(),
+                                         static_cast<std::size_t>(id));
+        return (it - m_offsets.begin()) - 1;
+    }
+
+    node_t const& node(int id) const
+    {
+        std::size_t const c = node_cluster(id);
+        return m_data[c].nodes[id - m_offsets[c]];
+    }
+
+    coord_t node_pos(int id) const { return node(id).pos; }
+
+    int node_id(coord_t pos) const
+    {
+        std::size_t const c = cluster_index(cluster_of(pos));
+        auto const& nodes = m_data[c].nodes;
+        for(std::size_t i = 0; i != nodes.size(); ++i)
+            if(nodes[i].pos == pos)
+                return static_cast<int>(m_offsets[c] + i);
+        assert(false);
+        return -1;
+    }
+
+    // Distances from 'crd' to each node of its cluster, or -1.
+    std::vector<int> node_dists(coord_t crd, std::vector<int>& scratch) const
+    {
+        cluster_t const& cluster = m_data[cluster_index(cluster_of(crd))];
+        impl::bounded_search(m_passable, cluster.rect, crd, nullptr, scratch);
+        std::vector<int> ret;
+        for(node_t const& node : cluster.nodes)
+        {
+            int const d =
+                scratch[grid_index(cluster.rect.d, node.pos - cluster.rect.c)];
+            ret.push_back(d == INT_MAX ? -1 : d);
+        }
+        return ret;
+    }
+
+    // Returns the sequence of abstract ids from start to goal.
+    std::vector<int> abstract_search(coord_t from, coord_t to) const
+    {
+        std::size_t const from_cluster = cluster_index(cluster_of(from));
+        std::size_t const to_cluster = cluster_index(cluster_of(to));
+        std::vector<int> scratch;
+        std::vector<int> const from_dists = node_dists(from, scratch);
+        std::vector<int> const to_dists = node_dists(to, scratch);
+        int const direct = from_cluster == to_cluster
+            ? impl::bounded_search(m_passable, m_data[from_cluster].rect,
+                                   from, &to, scratch)
+            : -1;
+
+        struct state_t
+        {
+            int g;
+            int parent;
+        };
+        std::unordered_map<int, state_t> states;
+        using entry_t = std::pair<int, int>; // f, id
+        std::priority_queue<entry_t, std::vector<entry_t>,
+                            std::greater<entry_t> > open;
+
+        auto const pos_of = [&](int id)
+        {
+            return id == start_id() ? from
+                 : id == goal_id() ? to
+                 : node_pos(id);
+        };
+        auto const relax = [&](int id, int parent, int g)
+        {
+            auto it = states.find(id);
+            if(it != states.end() && it->second.g <= g)
+                return;
+            states[id] = { g, parent };
+            open.push({ g + impl::octile_dist(pos_of(id), to), id });
+        };
+
+        states[start_id()] = { 0, -1 };
+        open.push({ impl::octile_dist(from, to), start_id() });
+        while(!open.empty())
+        {
+            entry_t const top = open.top();
+            open.pop();
+            int const id = top.second;
+            int const g = states[id].g;
+            if(top.first != g + impl::octile_dist(pos_of(id), to))
+                continue; // Stale entry.
+
+            if(id == goal_id())
+            {
+                std::vector<int> chain;
+                for(int i = id; i != -1; i = states[i].parent)
+                    chain.push_back(i);
+                std::reverse(chain.begin(), chain.end());
+                return chain;
+            }
+
+            if(id == start_id())
+            {
+                int const offset = m_offsets[from_cluster];
+                for(std::size_t j = 0; j != from_dists.size(); ++j)
+                    if(from_dists[j] >= 0)
+                        relax(offset + j, id, from_dists[j]);
+                if(direct >= 0)
+                    relax(goal_id(), id, direct);
+                continue;
+            }
+
+            std::size_t const c = node_cluster(id);
+            cluster_t const& cluster = m_data[c];
+            std::size_t const n = cluster.nodes.size();
+            std::size_t const i = id - m_offsets[c];
+            for(std::size_t j = 0; j != n; ++j)
+                if(j != i && cluster.dist[i * n + j] >= 0)
+                    relax(m_offsets[c] + j, id, g + cluster.dist[i * n + j]);
+            for(coord_t link : cluster.nodes[i].links)
+                relax(node_id(link), id, g + hpa_orth_cost);
+            if(c == to_cluster && to_dists[i] >= 0)
+                relax(goal_id(), id, g + to_dists[i]);
+        }
+        return {};
+    }
+
+    dimen_t m_dim;
+    int2d_t m_cluster_size;
+    dimen_t m_clusters;
+    Passable m_passable;
+    std::vector<cluster_t> m_data;
+    std::vector<std::size_t> m_offsets;
+};
+
+// Makes a pathfinder over 'grid', where cells are passable if
+// 'pred(cell_value)' is true. 'grid' must outlive the pathfinder.
+template<typename Grid, typename Pred>
+auto make_hpa_pathfinder(Grid const& grid, int2d_t cluster_size, Pred pred)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    auto passable = [&grid, pred](coord_t crd) { return pred(grid[crd]); };
+    return hpa_pathfinder_t<decltype(passable)>(
+        grid.dimen(), cluster_size, passable);
+}
+
+} // namespace i2d
+
+#endif
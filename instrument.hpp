@@ -0,0 +1,204 @@
+#ifndef INT2D_INSTRUMENT_HPP
+#define INT2D_INSTRUMENT_HPP
+
+// Optional counters for the library's hot paths.
+//
+// Define INT2D_INSTRUMENT before including any header to turn them on.
+// Otherwise INT2D_COUNT expands to nothing and the snapshot functions
+// return zeros. 'INT2D_COUNT(cells_visited, n)' adds 'n' to the counter
+// named by the first argument.
+//
+// Each thread counts into its own block, so counting is a plain load and
+// store with no locking. Snapshots add up the blocks of every thread,
+// including threads that have exited since the last reset.
+
+#include <cstdint>
+
+#ifdef INT2D_INSTRUMENT
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace i2d {
+
+struct instrument_counters_t
+{
+    std::uint64_t cells_visited = 0;
+    std::uint64_t lines_traced = 0;
+    std::uint64_t blits = 0;
+    std::uint64_t bytes_allocated = 0;
+    std::uint64_t resizes = 0;
+};
+
+#ifdef INT2D_INSTRUMENT
+
+constexpr bool instrument_enabled = true;
+
+namespace impl
+{
+    enum instrument_counter
+    {
+        instrument_cells_visited,
+        instrument_lines_traced,
+        instrument_blits,
+        instrument_bytes_allocated,
+        instrument_resizes,
+        instrument_counter_count,
+    };
+
+    struct instrument_block_t;
+
+    struct instrument_registry_t
+    {
+        std::mutex mutex;
+        std::vector<instrument_block_t*> blocks;
+        // Counts left behind by exited threads.
+        std::uint64_t retired[instrument_counter_count] = {};
+    };
+
+    inline instrument_registry_t& instrument_registry()
+    {
+        static instrument_registry_t registry;
+        return registry;
+    }
+
+    // One thread's counters. Only the owning thread writes 'counts', and
+    // only 'instrument_reset' writes 'base', under the registry's mutex.
+    struct instrument_block_t
+    {
+        std::atomic<std::uint64_t> counts[instrument_counter_count] = {};
+        std::atomic<std::uint64_t> base[instrument_counter_count] = {};
+
+        instrument_block_t()
+        {
+            instrument_registry_t& r = instrument_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.blocks.push_back(this);
+        }
+
+        ~instrument_block_t()
+        {
+            instrument_registry_t& r = instrument_registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for(int i = 0; i < instrument_counter_count; ++i)
+                r.retired[i] += since_reset(i);
+            r.blocks.erase(std::find(r.blocks.begin(), r.blocks.end(), this));
+        }
+
+        std::uint64_t since_reset(int i) const
+        {
+            return counts[i].load(std::memory_order_relaxed)
+                   - base[i].load(std::memory_order_relaxed);
+        }
+    };
+
+    inline instrument_block_t& instrument_block()
+    {
+        thread_local instrument_block_t block;
+        return block;
+    }
+
+    inline void instrument_add(instrument_counter i, std::uint64_t n)
+    {
+        std::atomic<std::uint64_t>& c = instrument_block().counts[i];
+        c.store(c.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+    }
+
+    inline instrument_counters_t to_counters(std::uint64_t const* c)
+    {
+        instrument_counters_t ret;
+        ret.cells_visited = c[instrument_cells_visited];
+        ret.lines_traced = c[instrument_lines_traced];
+        ret.blits = c[instrument_blits];
+        ret.bytes_allocated = c[instrument_bytes_allocated];
+        ret.resizes = c[instrument_resizes];
+        return ret;
+    }
+} // namespace impl
+
+#define INT2D_COUNT(counter, n) \
+    (::i2d::impl::instrument_add(::i2d::impl::instrument_##counter, \
+                                 static_cast<std::uint64_t>(n)))
+
+// The totals of every thread since the last reset.
+inline instrument_counters_t instrument_snapshot()
+{
+    impl::instrument_registry_t& r = impl::instrument_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::uint64_t sum[impl::instrument_counter_count];
+    for(int i = 0; i < impl::instrument_counter_count; ++i)
+    {
+        sum[i] = r.retired[i];
+        for(impl::instrument_block_t const* block : r.blocks)
+            sum[i] += block->since_reset(i);
+    }
+    return impl::to_counters(sum);
+}
+
+// The calling thread's counts since the last reset.
+inline instrument_counters_t instrument_thread_snapshot()
+{
+    impl::instrument_block_t const& block = impl::instrument_block();
+    std::uint64_t sum[impl::instrument_counter_count];
+    for(int i = 0; i < impl::instrument_counter_count; ++i)
+        sum[i] = block.since_reset(i);
+    return impl::to_counters(sum);
+}
+
+// Zeros every thread's counts.
+inline void instrument_reset()
+{
+    impl::instrument_registry_t& r = impl::instrument_registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for(int i = 0; i < impl::instrument_counter_count; ++i)
+    {
+        r.retired[i] = 0;
+        for(impl::instrument_block_t* block : r.blocks)
+            block->base[i].store(
+                block->counts[i].load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+    }
+}
+
+#else
+
+constexpr bool instrument_enabled = false;
+
+#define INT2D_COUNT(counter, n) ((void)0)
+
+inline instrument_counters_t instrument_snapshot() { return {}; }
+inline instrument_counters_t instrument_thread_snapshot() { return {}; }
+inline void instrument_reset() {}
+
+#endif
+
+// Writes 'c' to 'os' as one "name: value" line per counter.
+template<typename Stream>
+Stream& write_text(Stream& os, instrument_counters_t const& c)
+{
+    os << "cells_visited: " << c.cells_visited << '\n'
+       << "lines_traced: " << c.lines_traced << '\n'
+       << "blits: " << c.blits << '\n'
+       << "bytes_allocated: " << c.bytes_allocated << '\n'
+       << "resizes: " << c.resizes << '\n';
+    return os;
+}
+
+// Writes 'c' to 'os' as a single JSON object.
+template<typename Stream>
+Stream& write_json(Stream& os, instrument_counters_t const& c)
+{
+    os << "{\"cells_visited\":" << c.cells_visited
+       << ",\"lines_traced\":" << c.lines_traced
+       << ",\"blits\":" << c.blits
+       << ",\"bytes_allocated\":" << c.bytes_allocated
+       << ",\"resizes\":" << c.resizes << '}';
+    return os;
+}
+
+} // namespace i2d
+
+#endif
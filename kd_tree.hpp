@@ -0,0 +1,307 @@
+#ifndef INT2D_KD_TREE_HPP
+#define INT2D_KD_TREE_HPP
+
+// A static k-d tree over coords with a value for each point.
+//
+// The tree is implicit: points are stored in one array, arranged so that
+// the median of every range [b, e) is at its middle, with the lesser half
+// before it and the greater half after. Levels alternate between
+// splitting on x and on y. Nothing else is stored.
+//
+// Queries take the distance metric as a template parameter. They recurse
+// instead of keeping a stack and write to caller-supplied storage, so
+// they never allocate.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+// Metrics for tree queries. 'dist' gives comparable distances, which are
+// squared for 'e_dist_metric', and 'axis_dist' gives the least possible
+// distance to any point a given offset away along one axis.
+
+struct c_dist_metric
+{
+    static std::int64_t dist(coord_t a, coord_t b)
+    {
+        return std::max(std::abs(std::int64_t(a.x) - b.x),
+                        std::abs(std::int64_t(a.y) - b.y));
+    }
+
+    static std::int64_t axis_dist(std::int64_t d) { return std::abs(d); }
+    static std::int64_t from_radius(int2d_t r) { return r; }
+};
+
+struct m_dist_metric
+{
+    static std::int64_t dist(coord_t a, coord_t b)
+    {
+        return std::abs(std::int64_t(a.x) - b.x)
+               + std::abs(std::int64_t(a.y) - b.y);
+    }
+
+    static std::int64_t axis_dist(std::int64_t d) { return std::abs(d); }
+    static std::int64_t from_radius(int2d_t r) { return r; }
+};
+
+// Squares are taken in std::uint64_t, where they can't overflow, and
+// saturate at the largest std::int64_t. Only points more than about 3e9
+// apart saturate, and those all tie.
+struct e_dist_metric
+{
+    static std::int64_t dist(coord_t a, coord_t b)
+    {
+        std::uint64_t const dx2 = sqr(std::int64_t(a.x) - b.x);
+        std::uint64_t const dy2 = sqr(std::int64_t(a.y) - b.y);
+        std::uint64_t const sum = dx2 + dy2;
+        return saturate(sum < dx2 ? std::numeric_limits<std::uint64_t>::max()
+                                  : sum);
+    }
+
+    static std::int64_t axis_dist(std::int64_t d) { return saturate(sqr(d)); }
+    static std::int64_t from_radius(int2d_t r)
+    {
+        return std::int64_t(r) * r;
+    }
+private:
+    // 'd' is the difference of two int2d_t, so its square fits.
+    static std::uint64_t sqr(std::int64_t d)
+    {
+        std::uint64_t const a = d < 0 ? 0 - std::uint64_t(d)
+                                      : std::uint64_t(d);
+        return a * a;
+    }
+
+    static std::int64_t saturate(std::uint64_t d)
+    {
+        std::uint64_t const max = std::numeric_limits<std::int64_t>::max();
+        return std::int64_t(std::min(d, max));
+    }
+};
+
+// A point found by a query: its index in the tree and its distance from
+// the query in the metric's units.
+struct kd_neighbor_t
+{
+    std::size_t index;
+    std::int64_t dist;
+};
+
+template<typename T>
+class kd_tree_t
+{
+public:
+    using value_type = T;
+
+    kd_tree_t() = default;
+
+    // Builds from a range of std::pair<coord_t, T> in O(n log n). The top
+    // of the tree is split first, then the subtrees below it are built
+    // in parallel. Only 'opts.max_threads' is used.
+    template<typename It>
+    kd_tree_t(It begin, It end, parallel_opts_t opts = {})
+    {
+        std::vector<std::pair<coord_t, T>> points(begin, end);
+
+        struct task_t { std::size_t b, e; int axis; };
+        std::vector<task_t> tasks = { { 0, points.size(), 0 } };
+        unsigned threads = opts.max_threads;
+        if(threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        while(threads > 1 && tasks.size() < threads * 4)
+        {
+            std::vector<task_t> next;
+            for(task_t const& t : tasks)
+            {
+                if(t.e - t.b < min_parallel)
+                {
+                    next.push_back(t);
+                    continue;
+                }
+                std::size_t const mid = split(points, t.b, t.e, t.axis);
+                next.push_back({ t.b, mid, !t.axis });
+                next.push_back({ mid + 1, t.e, !t.axis });
+            }
+            if(next.size() == tasks.size())
+                break;
+            tasks.swap(next);
+        }
+
+        parallel_bands(0, static_cast<int2d_t>(tasks.size()),
+                       [&](int2d_t b, int2d_t e)
+        {
+            for(int2d_t i = b; i < e; ++i)
+                build(points, tasks[i].b, tasks[i].e, tasks[i].axis);
+        }, { 1, opts.max_threads });
+
+        m_crds.reserve(points.size());
+        m_values.reserve(points.size());
+        for(auto& p : points)
+        {
+            m_crds.push_back(p.first);
+            m_values.push_back(std::move(p.second));
+        }
+    }
+
+    std::size_t size() const { return m_crds.size(); }
+    bool empty() const { return m_crds.empty(); }
+
+    coord_t position(std::size_t i) const { return m_crds[i]; }
+    T const& value(std::size_t i) const { return m_values[i]; }
+
+    // Finds the point closest to 'crd'. Returns false if the tree is
+    // empty.
+    template<typename Metric>
+    bool nearest(coord_t crd, kd_neighbor_t& found) const
+    {
+        std::size_t const none = size();
+        found = { none, std::numeric_limits<std::int64_t>::max() };
+        // The first point is taken even if its distance saturated.
+        auto visit = [&found, none](std::size_t i, std::int64_t d)
+        {
+            if(d < found.dist || found.index == none)
+                found = { i, d };
+            return found.dist;
+        };
+        search<Metric>(0, size(), 0, crd, found.dist, visit);
+        return found.index != none;
+    }
+
+    // Finds up to 'k' points closest to 'crd', writing them to 'out'
+    // nearest first. 'out' must have room for 'k' neighbors. Returns the
+    // number found, which is less than 'k' only when the tree is smaller.
+    template<typename Metric>
+    std::size_t nearest_k(coord_t crd, std::size_t k,
+                          kd_neighbor_t* out) const
+    {
+        if(k == 0)
+            return 0;
+        // 'out' is kept as a max heap of the best so far.
+        auto const less = [](kd_neighbor_t const& a, kd_neighbor_t const& b)
+        {
+            return a.dist < b.dist;
+        };
+        std::size_t count = 0;
+        std::int64_t bound = std::numeric_limits<std::int64_t>::max();
+        auto visit = [&](std::size_t i, std::int64_t d)
+        {
+            if(count < k)
+            {
+                out[count++] = { i, d };
+                std::push_heap(out, out + count, less);
+            }
+            else if(d < out[0].dist)
+            {
+                std::pop_heap(out, out + k, less);
+                out[k - 1] = { i, d };
+                std::push_heap(out, out + k, less);
+            }
+            return count < k ? bound : out[0].dist;
+        };
+        search<Metric>(0, size(), 0, crd, bound, visit);
+        std::sort_heap(out, out + count, less);
+        return count;
+    }
+
+    // Calls 'func(kd_neighbor_t)' for each point within 'radius' of 'crd',
+    // in no particular order.
+    template<typename Metric, typename Func>
+    void for_each_within(coord_t crd, int2d_t radius, Func func) const
+    {
+        std::int64_t bound = Metric::from_radius(radius);
+        auto visit = [&](std::size_t i, std::int64_t d)
+        {
+            func(kd_neighbor_t{ i, d });
+            return bound;
+        };
+        search<Metric>(0, size(), 0, crd, bound, visit);
+    }
+
+private:
+    // Ranges smaller than this aren't worth building on their own thread.
+    static constexpr std::size_t min_parallel = 4096;
+
+    static int2d_t key(coord_t crd, int axis) { return axis ? crd.y : crd.x; }
+
+    // Moves the median of [b, e) to the middle, returning its index.
+    static std::size_t split(std::vector<std::pair<coord_t, T>>& points,
+                             std::size_t b, std::size_t e, int axis)
+    {
+        std::size_t const mid = b + (e - b) / 2;
+        std::nth_element(points.begin() + b, points.begin() + mid,
+                         points.begin() + e,
+                         [axis](std::pair<coord_t, T> const& l,
+                                std::pair<coord_t, T> const& r)
+                         {
+                             return key(l.first, axis) < key(r.first, axis);
+                         });
+        return mid;
+    }
+
+    static void build(std::vector<std::pair<coord_t, T>>& points,
+                      std::size_t b, std::size_t e, int axis)
+    {
+        while(e - b > 1)
+        {
+            std::size_t const mid = split(points, b, e, axis);
+            build(points, b, mid, !axis);
+            b = mid + 1;
+            axis = !axis;
+        }
+    }
+
+    // Calls 'visit(index, dist)' for each point of [b, e) within 'bound'.
+    // 'visit' returns the new bound, which may only shrink.
+    template<typename Metric, typename Visit>
+    void search(std::size_t b, std::size_t e, int axis, coord_t crd,
+                std::int64_t& bound, Visit& visit) const
+    {
+        while(b < e)
+        {
+            std::size_t const mid = b + (e - b) / 2;
+            coord_t const p = m_crds[mid];
+            std::int64_t const d = Metric::dist(p, crd);
+            if(d <= bound)
+                bound = visit(mid, d);
+
+            // Search the side 'crd' is on first, then the other side
+            // only if it could still hold a point within the bound.
+            std::int64_t const delta =
+                std::int64_t(key(crd, axis)) - key(p, axis);
+            if(delta < 0)
+            {
+                search<Metric>(b, mid, !axis, crd, bound, visit);
+                b = mid + 1;
+            }
+            else
+            {
+                search<Metric>(mid + 1, e, !axis, crd, bound, visit);
+                e = mid;
+            }
+            if(Metric::axis_dist(delta) > bound)
+                return;
+            axis = !axis;
+        }
+    }
+
+    std::vector<coord_t> m_crds;
+    std::vector<T> m_values;
+};
+
+template<typename T>
+constexpr std::size_t kd_tree_t<T>::min_parallel;
+
+} // namespace i2d
+
+#endif
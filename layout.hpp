@@ -0,0 +1,268 @@
+#ifndef INT2D_LAYOUT_HPP
+#define INT2D_LAYOUT_HPP
+
+// Trees of rects laid out inside their parents.
+//
+// Each node holds a 'layout_rule_t' naming one of the panel, margin, or
+// centering functions from geometry.hpp, and its rect is that function
+// applied to its parent's rect.
+//
+// 'layout_tree_t' keeps every node's rect and recomputes only the
+// subtrees under nodes whose rule or parent rect changed. Layouts known
+// at compile time can instead be written as an array and evaluated in
+// a constant expression with 'evaluate_layout'.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace i2d {
+
+enum class layout_op
+{
+    fill,     // The parent's rect.
+    lpanel,   // lpanel(parent, a)
+    rpanel,   // rpanel(parent, a)
+    upanel,   // upanel(parent, a)
+    dpanel,   // dpanel(parent, a)
+    margin,   // rect_margin(parent, a, b, c, d)
+    centered, // centered_inside({ a, b }, parent)
+};
+
+struct layout_rule_t
+{
+    layout_op op;
+    int2d_t a;
+    int2d_t b;
+    int2d_t c;
+    int2d_t d;
+};
+
+constexpr bool operator==(layout_rule_t lhs, layout_rule_t rhs)
+{
+    return lhs.op == rhs.op && lhs.a == rhs.a && lhs.b == rhs.b
+           && lhs.c == rhs.c && lhs.d == rhs.d;
+}
+
+constexpr bool operator!=(layout_rule_t lhs, layout_rule_t rhs)
+{
+    return !(lhs == rhs);
+}
+
+constexpr layout_rule_t fill_layout()
+{
+    return { layout_op::fill, 0, 0, 0, 0 };
+}
+
+constexpr layout_rule_t lpanel_layout(int2d_t w)
+{
+    return { layout_op::lpanel, w, 0, 0, 0 };
+}
+
+constexpr layout_rule_t rpanel_layout(int2d_t w)
+{
+    return { layout_op::rpanel, w, 0, 0, 0 };
+}
+
+constexpr layout_rule_t upanel_layout(int2d_t h)
+{
+    return { layout_op::upanel, h, 0, 0, 0 };
+}
+
+constexpr layout_rule_t dpanel_layout(int2d_t h)
+{
+    return { layout_op::dpanel, h, 0, 0, 0 };
+}
+
+constexpr layout_rule_t margin_layout(int2d_t left, int2d_t top,
+                                      int2d_t right, int2d_t bottom)
+{
+    return { layout_op::margin, left, top, right, bottom };
+}
+
+constexpr layout_rule_t margin_layout(int2d_t margin)
+{
+    return margin_layout(margin, margin, margin, margin);
+}
+
+constexpr layout_rule_t centered_layout(dimen_t dim)
+{
+    return { layout_op::centered, dim.w, dim.h, 0, 0 };
+}
+
+constexpr rect_t apply_layout(layout_rule_t rule, rect_t parent)
+{
+    switch(rule.op)
+    {
+    case layout_op::lpanel: return lpanel(parent, rule.a);
+    case layout_op::rpanel: return rpanel(parent, rule.a);
+    case layout_op::upanel: return upanel(parent, rule.a);
+    case layout_op::dpanel: return dpanel(parent, rule.a);
+    case layout_op::margin:
+        return rect_margin(parent, rule.a, rule.b, rule.c, rule.d);
+    case layout_op::centered:
+        return centered_inside({ rule.a, rule.b }, parent);
+    default: return parent;
+    }
+}
+
+// An entry of a static layout. Entry 0 is the root, and every other
+// entry's parent must come before it.
+struct layout_item_t
+{
+    std::size_t parent;
+    layout_rule_t rule;
+};
+
+template<std::size_t N>
+struct static_layout_t
+{
+    rect_t rects[N];
+
+    constexpr rect_t operator[](std::size_t i) const { return rects[i]; }
+    static constexpr std::size_t size() { return N; }
+};
+
+// Lays out 'items' inside 'root'. The root's rule is applied to 'root'.
+template<std::size_t N>
+constexpr static_layout_t<N> evaluate_layout(layout_item_t const (&items)[N],
+                                             rect_t root)
+{
+    static_layout_t<N> ret = {};
+    for(std::size_t i = 0; i < N; ++i)
+    {
+        rect_t const parent = i == 0 ? root : ret.rects[items[i].parent];
+        ret.rects[i] = apply_layout(items[i].rule, parent);
+    }
+    return ret;
+}
+
+class layout_tree_t
+{
+public:
+    using node_id = std::uint32_t;
+
+    enum : node_id { root = 0 };
+
+    explicit layout_tree_t(rect_t root_rect = {})
+    {
+        m_nodes.push_back({ none, none, none, none, 0, fill_layout(),
+                            root_rect, false });
+    }
+
+    std::size_t size() const { return m_nodes.size(); }
+
+    // Adds the last child of 'parent'. Its rect is valid after 'update'.
+    node_id add(node_id parent, layout_rule_t rule)
+    {
+        assert(parent < m_nodes.size());
+        node_id const id = static_cast<node_id>(m_nodes.size());
+        m_nodes.push_back({ parent, none, none, none,
+                            m_nodes[parent].depth + 1, rule, {}, false });
+        node_id& link = m_nodes[parent].last_child;
+        if(link == none)
+            m_nodes[parent].first_child = id;
+        else
+            m_nodes[link].next_sibling = id;
+        link = id;
+        mark(id);
+        return id;
+    }
+
+    void set_root_rect(rect_t r)
+    {
+        if(r == m_nodes[root].rect)
+            return;
+        m_nodes[root].rect = r;
+        for(node_id c = m_nodes[root].first_child; c != none;
+            c = m_nodes[c].next_sibling)
+            mark(c);
+    }
+
+    void set_rule(node_id id, layout_rule_t rule)
+    {
+        assert(id != root && id < m_nodes.size());
+        if(m_nodes[id].rule == rule)
+            return;
+        m_nodes[id].rule = rule;
+        mark(id);
+    }
+
+    layout_rule_t rule(node_id id) const { return m_nodes[id].rule; }
+    node_id parent(node_id id) const { return m_nodes[id].parent; }
+
+    // The rect of 'id' as of the last 'update'.
+    rect_t rect(node_id id) const { return m_nodes[id].rect; }
+
+    bool dirty() const { return !m_dirty.empty(); }
+
+    // Recomputes the subtrees under nodes changed since the last call.
+    // Children of a node whose rect comes out the same are skipped
+    // unless they were changed themselves.
+    void update()
+    {
+        // Shallowest first, so changed descendants are handled as part
+        // of their ancestors' subtrees.
+        std::sort(m_dirty.begin(), m_dirty.end(),
+                  [this](node_id a, node_id b)
+                  {
+                      return m_nodes[a].depth < m_nodes[b].depth;
+                  });
+        for(node_id id : m_dirty)
+        {
+            if(!m_nodes[id].dirty)
+                continue;
+            m_stack.push_back(id);
+            while(!m_stack.empty())
+            {
+                node_t& node = m_nodes[m_stack.back()];
+                m_stack.pop_back();
+                rect_t const r =
+                    apply_layout(node.rule, m_nodes[node.parent].rect);
+                bool const changed = r != node.rect;
+                node.rect = r;
+                node.dirty = false;
+                for(node_id c = node.first_child; c != none;
+                    c = m_nodes[c].next_sibling)
+                    if(changed || m_nodes[c].dirty)
+                        m_stack.push_back(c);
+            }
+        }
+        m_dirty.clear();
+    }
+
+private:
+    enum : node_id { none = ~node_id(0) };
+
+    struct node_t
+    {
+        node_id parent;
+        node_id first_child;
+        node_id last_child;
+        node_id next_sibling;
+        std::uint32_t depth;
+        layout_rule_t rule;
+        rect_t rect;
+        bool dirty;
+    };
+
+    void mark(node_id id)
+    {
+        if(m_nodes[id].dirty)
+            return;
+        m_nodes[id].dirty = true;
+        m_dirty.push_back(id);
+    }
+
+    std::vector<node_t> m_nodes;
+    std::vector<node_id> m_dirty;
+    std::vector<node_id> m_stack;
+};
+
+} // namespace i2d
+
+#endif
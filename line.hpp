@@ -3,195 +3,240 @@
 
 // Generic Bressenham line algorithm code.
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <functional>
 #include <iterator>
 
 #include "geometry.hpp"
+#include "instrument.hpp"
 #include "units.hpp"
 
 namespace i2d {
 
 // A wrapper around the state of Bressenham's line algorithm.
+// 'error' and step counts are promoted so that int16 lines can't overflow.
 // NOTE: A dir vector of {0,0} is considered invalid.
-struct line_state_t
+template<typename S>
+struct basic_line_state_t
 {
-    coord_t pos;
-    coord_t dir;
-    int error;
+    using coord_type = basic_coord_t<S>;
+    using error_type = promoted_t<S>;
 
-    // Use these to construct 'line_state_t'.
+    coord_type pos;
+    coord_type dir;
+    error_type error;
+
+    // Use these to construct 'basic_line_state_t'.
     // Aggregate initialization isn't recommended because 'error' needs
     // to be set.
-    static line_state_t pos_dir(coord_t pos, coord_t dir);
-    static line_state_t from_to(coord_t from, coord_t to);
+    static basic_line_state_t pos_dir(coord_type pos, coord_type dir);
+    static basic_line_state_t from_to(coord_type from, coord_type to);
 
     // The starting 'error' value for a given dir.
     // Starts the line right in the middle.
-    static int dir_err(coord_t dir);
+    static error_type dir_err(coord_type dir);
 
-    static line_state_t next(line_state_t line);
-    static line_state_t next(line_state_t line, int2d_t n);
-    static line_state_t prev(line_state_t line);
-    static line_state_t prev(line_state_t line, int2d_t n);
+    static basic_line_state_t next(basic_line_state_t line);
+    static basic_line_state_t next(basic_line_state_t line, error_type n);
+    static basic_line_state_t prev(basic_line_state_t line);
+    static basic_line_state_t prev(basic_line_state_t line, error_type n);
 
-    static line_state_t hflipped(line_state_t line);
-    static line_state_t vflipped(line_state_t line);
+    static basic_line_state_t hflipped(basic_line_state_t line);
+    static basic_line_state_t vflipped(basic_line_state_t line);
 
     void advance() { *this = next(*this); }
-    void advance(int2d_t n) { *this = next(*this, n); }
+    void advance(error_type n) { *this = next(*this, n); }
     void radvance() { *this = prev(*this); }
-    void radvance(int2d_t n) { *this = prev(*this, n); }
+    void radvance(error_type n) { *this = prev(*this, n); }
     void hflip() { *this = hflipped(*this); }
     void vflip() { *this = vflipped(*this); }
 
-    explicit operator bool() const { return dir != coord_t{0,0}; }
+    explicit operator bool() const { return dir != coord_type{0,0}; }
 };
 
-constexpr bool operator==(line_state_t lhs, line_state_t rhs)
+using line_state_t = basic_line_state_t<int2d_t>;
+
+template<typename S>
+constexpr bool operator==(basic_line_state_t<S> lhs, basic_line_state_t<S> rhs)
 {
     return (lhs.pos == rhs.pos
             && lhs.dir == rhs.dir
             && lhs.error == rhs.error);
 }
 
-constexpr bool operator!=(line_state_t lhs, line_state_t rhs)
+template<typename S>
+constexpr bool operator!=(basic_line_state_t<S> lhs, basic_line_state_t<S> rhs)
 {
     return !(lhs == rhs);
 }
 
-class line_iterator
-: public std::iterator<std::random_access_iterator_tag, coord_t const>
+template<typename S>
+class basic_line_range;
+
+template<typename S>
+class basic_line_iterator
+: public std::iterator<std::random_access_iterator_tag,
+                       basic_coord_t<S> const>
 {
-    friend class line_range;
+    friend class basic_line_range<S>;
 public:
-    line_iterator() : m_state{} {}
-    explicit line_iterator(line_state_t state) : m_state(state) {}
+    using coord_type = basic_coord_t<S>;
+    using state_type = basic_line_state_t<S>;
+    using step_type = typename state_type::error_type;
 
-    coord_t operator*() const { return m_state.pos; }
-    coord_t const* operator->() const { return &m_state.pos; }
+    basic_line_iterator() : m_state{} {}
+    explicit basic_line_iterator(state_type state) : m_state(state) {}
 
-    line_iterator& operator+=(int2d_t n) { m_state.advance(n); return *this; }
-    line_iterator& operator++() { m_state.advance(); return *this; }
-    line_iterator operator++(int2d_t)
+    coord_type operator*() const { return m_state.pos; }
+    coord_type const* operator->() const { return &m_state.pos; }
+
+    basic_line_iterator& operator+=(step_type n)
+    {
+        m_state.advance(n);
+        return *this;
+    }
+    basic_line_iterator& operator++() { m_state.advance(); return *this; }
+    basic_line_iterator operator++(int)
     {
-        line_iterator ret(*this);
+        basic_line_iterator ret(*this);
         ++(*this);
         return ret;
     }
 
-    line_iterator& operator-=(int2d_t n) { m_state.radvance(n); return *this; }
-    line_iterator& operator--() { m_state.radvance(); return *this; }
-    line_iterator operator--(int2d_t)
+    basic_line_iterator& operator-=(step_type n)
     {
-        line_iterator ret(*this);
+        m_state.radvance(n);
+        return *this;
+    }
+    basic_line_iterator& operator--() { m_state.radvance(); return *this; }
+    basic_line_iterator operator--(int)
+    {
+        basic_line_iterator ret(*this);
         --(*this);
         return ret;
     }
 
-    line_iterator operator+(int2d_t rhs) const
+    basic_line_iterator operator+(step_type rhs) const
     {
-        line_iterator lhs = *this;
+        basic_line_iterator lhs = *this;
         lhs += rhs;
         return lhs;
     }
 
-    line_iterator operator-(int2d_t rhs) const
+    basic_line_iterator operator-(step_type rhs) const
     {
-        line_iterator lhs = *this;
+        basic_line_iterator lhs = *this;
         lhs -= rhs;
         return lhs;
     }
 
-    coord_t operator[](std::size_t i) { return *(*this + i); }
+    coord_type operator[](std::size_t i) { return *(*this + i); }
 
-    line_state_t state() const { return m_state; }
+    state_type state() const { return m_state; }
 private:
-    line_state_t m_state;
+    state_type m_state;
 };
 
-std::size_t operator-(line_iterator lhs, line_iterator rhs);
+using line_iterator = basic_line_iterator<int2d_t>;
+
+template<typename S>
+std::size_t operator-(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs);
 
-inline bool operator==(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator==(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     assert(*lhs != *rhs || lhs.state() == rhs.state());
     return *lhs == *rhs;
 }
 
-inline bool operator!=(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator!=(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return !(lhs == rhs);
 }
 
-bool operator<(line_iterator lhs, line_iterator rhs);
-bool operator<=(line_iterator lhs, line_iterator rhs);
-bool operator>(line_iterator lhs, line_iterator rhs);
-bool operator>=(line_iterator lhs, line_iterator rhs);
-
-class line_range
+template<typename S>
+bool operator<(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs);
+template<typename S>
+bool operator<=(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs);
+template<typename S>
+bool operator>(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs);
+template<typename S>
+bool operator>=(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs);
+
+template<typename S>
+class basic_line_range
 {
 public:
-    using const_iterator = line_iterator;
+    using const_iterator = basic_line_iterator<S>;
+    using coord_type = basic_coord_t<S>;
+    using state_type = basic_line_state_t<S>;
+    using step_type = typename state_type::error_type;
 
-    line_range() = default;
+    basic_line_range() = default;
 
-    explicit line_range(coord_t crd)
-    : m_begin({ crd, { 1, 0 }, 0 })
-    , m_end({ crd + coord_t{ 1, 0 }, { 1, 0 }, 0 })
+    explicit basic_line_range(coord_type crd)
+    : m_begin(state_type{ crd, { 1, 0 }, 0 })
+    , m_end(state_type{ crd + coord_type{ 1, 0 }, { 1, 0 }, 0 })
     {}
 
-    line_range(coord_t from, coord_t to)
-    : line_range(line_state_t::from_to(from, to), c_dist(from, to) + 1)
+    basic_line_range(coord_type from, coord_type to)
+    : basic_line_range(state_type::from_to(from, to), c_dist(from, to) + 1)
     {}
 
     // NOTE: A dir vector of {0,0} is considered invalid.
-    line_range(coord_t pos, coord_t dir, int2d_t steps)
-    : line_range(line_state_t::pos_dir(pos, dir), steps)
+    basic_line_range(coord_type pos, coord_type dir, step_type steps)
+    : basic_line_range(state_type::pos_dir(pos, dir), steps)
     {
-        assert((dir != coord_t{0,0}));
+        assert((dir != coord_type{0,0}));
     }
 
-    line_range(line_state_t begin, int2d_t steps)
+    basic_line_range(state_type begin, step_type steps)
     : m_begin(begin)
-    , m_end(line_state_t::next(begin, steps))
+    , m_end(state_type::next(begin, steps))
     {}
 
-    line_iterator begin() const { return m_begin; }
-    line_iterator end() const { return m_end; }
+    const_iterator begin() const { return m_begin; }
+    const_iterator end() const { return m_end; }
 
-    line_iterator cbegin() const { return m_begin; }
-    line_iterator cend() const { return m_end; }
+    const_iterator cbegin() const { return m_begin; }
+    const_iterator cend() const { return m_end; }
 
     std::size_t size() const { return cend() - cbegin(); }
 
-    coord_t first() const { return *m_begin; }
-    coord_t last() const { return *(m_end - 1); }
+    coord_type first() const { return *m_begin; }
+    coord_type last() const { return *(m_end - 1); }
 
     void lengthen() { ++m_end; }
     void shorten() { --m_end; }
 private:
-    line_iterator m_begin;
-    line_iterator m_end;
+    const_iterator m_begin;
+    const_iterator m_end;
 };
 
+using line_range = basic_line_range<int2d_t>;
+
 namespace impl
 {
-    constexpr bool is_steep(coord_t dir)
+    template<typename S>
+    constexpr bool is_steep(basic_coord_t<S> dir)
     {
         return sqr(dir.y) > sqr(dir.x);
     }
 
-    inline coord_t coord_abs(coord_t dir)
+    template<typename S>
+    basic_coord_t<S> coord_abs(basic_coord_t<S> dir)
     {
-        return { std::abs(dir.x), std::abs(dir.y) };
+        return { S(std::abs(dir.x)), S(std::abs(dir.y)) };
     }
 
     // The version of Bressenham being used requires x and y to swap when
     // the line is steeper than 45 degrees.
     // This function simplifies the swapping.
-    template<typename Func>
-    auto steep_swap(line_state_t line, Func func)
+    template<typename S, typename Func>
+    auto steep_swap(basic_line_state_t<S> line, Func func)
     {
         if(is_steep(line.dir))
             return func(line, component_index<1>{}, component_index<0>{});
@@ -224,36 +269,45 @@ namespace impl
 
 // Calls 'it_func' with each coordinate of the line.
 // This may be slightly faster than line_state_t and line_range.
-template<typename Func>
-void iterate_line(coord_t from, coord_t to, Func it_func)
+template<typename S = int2d_t, typename Func>
+void iterate_line(basic_coord_t<S> from, basic_coord_t<S> to, Func it_func)
 {
     // Using a slightly different algorithm than line_state_t.
     // This version doesn't need to swap x or y.
-    coord_t const dir = to - from;
-    coord_t const d = impl::coord_abs(dir);
-    coord_t const s = mapc(dir, &impl::signum<int2d_t>);
-    for(int2d_t err = d.x - d.y; it_func(from), from != to;)
+    // 'err' and the deltas are promoted so that int16 lines can't overflow.
+    using P = promoted_t<S>;
+    P const dx = impl::abs_diff(from.x, to.x);
+    P const dy = impl::abs_diff(from.y, to.y);
+    S const sx = from.x < to.x ? 1 : -1;
+    S const sy = from.y < to.y ? 1 : -1;
+    INT2D_COUNT(lines_traced, 1);
+    INT2D_COUNT(cells_visited, std::max(dx, dy) + 1);
+    for(P err = dx - dy; it_func(from), from != to;)
     {
-        int2d_t const err2 = 2 * err;
-        if(err2 > -d.y)
+        P const err2 = 2 * err;
+        if(err2 > -dy)
         {
-            err -= d.y;
-            from.x += s.x;
+            err -= dy;
+            from.x += sx;
         }
-        if(err2 < d.x)
+        if(err2 < dx)
         {
-            err += d.x;
-            from.y += s.y;
+            err += dx;
+            from.y += sy;
         }
     }
 }
 
-inline line_state_t line_state_t::pos_dir(coord_t pos, coord_t dir)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::pos_dir(coord_type pos,
+                                                     coord_type dir)
 {
     return { pos, dir, dir_err(dir) };
 }
 
-inline line_state_t line_state_t::from_to(coord_t from, coord_t to)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::from_to(coord_type from,
+                                                     coord_type to)
 {
     if(from == to)
         return pos_dir(from, {1,0});
@@ -261,21 +315,23 @@ inline line_state_t line_state_t::from_to(coord_t from, coord_t to)
         return pos_dir(from, to - from);
 }
 
-inline int2d_t line_state_t::dir_err(coord_t dir)
+template<typename S>
+promoted_t<S> basic_line_state_t<S>::dir_err(coord_type dir)
 {
     using namespace impl;
-    return std::abs(is_steep(dir) ? dir.y : dir.x);
+    return std::abs(error_type(is_steep(dir) ? dir.y : dir.x));
 }
 
-inline line_state_t line_state_t::next(line_state_t line)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::next(basic_line_state_t line)
 {
     using namespace impl;
-    assert((line.dir != coord_t{0,0}));
+    assert((line.dir != coord_type{0,0}));
     // This is 1 iteration of Bressenham's line algorithm.
     return impl::steep_swap(line,
-        [](line_state_t line, auto cx, auto cy)
+        [](basic_line_state_t line, auto cx, auto cy)
         {
-            coord_t const d = impl::coord_abs(line.dir);
+            auto const d = coord_cast<error_type>(impl::coord_abs(line.dir));
             line.pos[cx] += impl::signum(line.dir[cx]);
             line.error -= d[cy] * 2;
             if(line.error < 0)
@@ -287,13 +343,14 @@ inline line_state_t line_state_t::next(line_state_t line)
         });
 }
 
-inline line_state_t line_state_t::prev(line_state_t line)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::prev(basic_line_state_t line)
 {
-    assert((line.dir != coord_t{0,0}));
+    assert((line.dir != coord_type{0,0}));
     return impl::steep_swap(line,
-        [](line_state_t line, auto cx, auto cy)
+        [](basic_line_state_t line, auto cx, auto cy)
         {
-            coord_t const d = impl::coord_abs(line.dir);
+            auto const d = coord_cast<error_type>(impl::coord_abs(line.dir));
             line.pos[cx] -= impl::signum(line.dir[cx]);
             line.error += d[cy] * 2;
             if(line.error > d[cx] * 2)
@@ -308,16 +365,19 @@ inline line_state_t line_state_t::prev(line_state_t line)
 namespace impl
 {
 
-    inline static line_state_t next_impl(line_state_t line, int2d_t n)
+    template<typename S>
+    basic_line_state_t<S> next_impl(basic_line_state_t<S> line,
+                                    promoted_t<S> n)
     {
-        assert((line.dir != coord_t{0,0}));
+        using P = promoted_t<S>;
+        assert((line.dir != basic_coord_t<S>{0,0}));
         return impl::steep_swap(line,
-            [n](line_state_t line, auto cx, auto cy)
+            [n](basic_line_state_t<S> line, auto cx, auto cy)
             {
-                coord_t const d2 = vec_mul(impl::coord_abs(line.dir), 2);
+                auto const d2 = vec_mul(coord_cast<P>(coord_abs(line.dir)), 2);
                 line.pos[cx] += n * impl::signum(line.dir[cx]);
                 line.error -= d2[cy] * n;
-                int2d_t const y_change = (d2[cx] - line.error - 1) / d2[cx];
+                P const y_change = (d2[cx] - line.error - 1) / d2[cx];
                 assert(y_change >= 0);
                 line.pos[cy] += y_change * impl::signum(line.dir[cy]);
                 line.error += y_change * d2[cx];
@@ -325,16 +385,19 @@ namespace impl
             });
     }
 
-    inline static line_state_t prev_impl(line_state_t line, int2d_t n)
+    template<typename S>
+    basic_line_state_t<S> prev_impl(basic_line_state_t<S> line,
+                                    promoted_t<S> n)
     {
-        assert((line.dir != coord_t{0,0}));
+        using P = promoted_t<S>;
+        assert((line.dir != basic_coord_t<S>{0,0}));
         return impl::steep_swap(line,
-            [n](line_state_t line, auto cx, auto cy)
+            [n](basic_line_state_t<S> line, auto cx, auto cy)
             {
-                coord_t const d2 = vec_mul(impl::coord_abs(line.dir), 2);
+                auto const d2 = vec_mul(coord_cast<P>(coord_abs(line.dir)), 2);
                 line.pos[cx] -= n * impl::signum(line.dir[cx]);
                 line.error += d2[cy] * n;
-                int2d_t const y_change = (line.error - 1) / d2[cx];
+                P const y_change = (line.error - 1) / d2[cx];
                 assert(y_change >= 0);
                 line.pos[cy] -= y_change * impl::signum(line.dir[cy]);
                 line.error -= y_change * d2[cx];
@@ -346,7 +409,9 @@ namespace impl
 
 // This is the same as repeatedly calling next(line) n times,
 // except this function has O(1) complexity instead of O(1).
-inline line_state_t line_state_t::next(line_state_t line, int2d_t n)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::next(basic_line_state_t line,
+                                                  error_type n)
 {
     if(n < 0)
         return impl::prev_impl(line, -n);
@@ -354,7 +419,9 @@ inline line_state_t line_state_t::next(line_state_t line, int2d_t n)
         return impl::next_impl(line, n);
 }
 
-inline line_state_t line_state_t::prev(line_state_t line, int2d_t n)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::prev(basic_line_state_t line,
+                                                  error_type n)
 {
     if(n < 0)
         return impl::next_impl(line, -n);
@@ -362,54 +429,63 @@ inline line_state_t line_state_t::prev(line_state_t line, int2d_t n)
         return impl::prev_impl(line, n);
 }
 
-inline line_state_t line_state_t::hflipped(line_state_t line)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::hflipped(basic_line_state_t line)
 {
     // TODO: Should error be updated?
     line.dir.x *= -1;
     return line;
 }
 
-inline line_state_t line_state_t::vflipped(line_state_t line)
+template<typename S>
+basic_line_state_t<S> basic_line_state_t<S>::vflipped(basic_line_state_t line)
 {
     // TODO: Should error be changed?
     line.dir.y *= -1;
     return line;
 }
 
-inline std::size_t operator-(line_iterator lhs, line_iterator rhs)
+template<typename S>
+std::size_t operator-(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return c_dist(*lhs, *rhs);
 }
 
 namespace impl
 {
-    inline static int2d_t iter_cmp(line_iterator lhs, line_iterator rhs)
+    template<typename S>
+    promoted_t<S> iter_cmp(basic_line_iterator<S> lhs,
+                           basic_line_iterator<S> rhs)
     {
-        coord_t p2 = *rhs;
+        basic_coord_t<S> p2 = *rhs;
         return impl::steep_swap(lhs.state(),
-            [p2](line_state_t l1, auto cx, auto cy)
+            [p2](basic_line_state_t<S> l1, auto cx, auto cy)
             {
-                return (l1.pos[cx] - p2[cx]) * l1.dir[cx];
+                return promoted_t<S>((l1.pos[cx] - p2[cx]) * l1.dir[cx]);
             });
     }
 }
 
-inline bool operator<(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator<(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return impl::iter_cmp(lhs, rhs) < 0;
 }
 
-inline bool operator<=(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator<=(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return impl::iter_cmp(lhs, rhs) <= 0;
 }
 
-inline bool operator>(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator>(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return impl::iter_cmp(lhs, rhs) > 0;
 }
 
-inline bool operator>=(line_iterator lhs, line_iterator rhs)
+template<typename S>
+bool operator>=(basic_line_iterator<S> lhs, basic_line_iterator<S> rhs)
 {
     return impl::iter_cmp(lhs, rhs) >= 0;
 }
@@ -0,0 +1,442 @@
+#ifndef INT2D_LINE_RASTER_HPP
+#define INT2D_LINE_RASTER_HPP
+
+// Line rasterizers beyond the thin 8-connected lines of line.hpp.
+//
+// 'ortho_line_t' visits cells in the order the segment between two cell
+// centers crosses into them. Its four-connected form steps x before y
+// when the segment passes exactly through a corner. Its supercover form
+// visits both cells at such corners, giving every cell the segment
+// touches.
+//
+// 'thick_line_t' sweeps a cross-section of cells along an 8-connected
+// line, so that the line is roughly 'width' cells wide measured
+// perpendicular to it.
+//
+// Like 'line_state_t', both can seek to any cell in O(1), and so have
+// random access iterators. The 'iterate_*' functions are faster when
+// visiting every cell in order.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+
+#include "geometry.hpp"
+#include "line.hpp"
+#include "units.hpp"
+
+namespace i2d {
+
+// Random access iterator over anything with 'operator[](std::size_t)'.
+template<typename Line>
+class indexed_line_iterator
+: public std::iterator<std::random_access_iterator_tag, coord_t const>
+{
+public:
+    indexed_line_iterator() = default;
+    indexed_line_iterator(Line const& line, std::size_t i)
+    : m_line(&line)
+    , m_i(i)
+    {}
+
+    coord_t operator*() const { return (*m_line)[m_i]; }
+
+    indexed_line_iterator& operator+=(std::ptrdiff_t n)
+    {
+        m_i += n;
+        return *this;
+    }
+    indexed_line_iterator& operator-=(std::ptrdiff_t n)
+    {
+        m_i -= n;
+        return *this;
+    }
+    indexed_line_iterator& operator++() { ++m_i; return *this; }
+    indexed_line_iterator& operator--() { --m_i; return *this; }
+
+    indexed_line_iterator operator++(int)
+    {
+        indexed_line_iterator ret(*this);
+        ++(*this);
+        return ret;
+    }
+
+    indexed_line_iterator operator--(int)
+    {
+        indexed_line_iterator ret(*this);
+        --(*this);
+        return ret;
+    }
+
+    indexed_line_iterator operator+(std::ptrdiff_t n) const
+    {
+        indexed_line_iterator ret(*this);
+        return ret += n;
+    }
+
+    indexed_line_iterator operator-(std::ptrdiff_t n) const
+    {
+        indexed_line_iterator ret(*this);
+        return ret -= n;
+    }
+
+    coord_t operator[](std::ptrdiff_t n) const { return *(*this + n); }
+
+    std::size_t index() const { return m_i; }
+private:
+    Line const* m_line = nullptr;
+    std::size_t m_i = 0;
+};
+
+template<typename Line>
+std::ptrdiff_t operator-(indexed_line_iterator<Line> lhs,
+                         indexed_line_iterator<Line> rhs)
+{
+    return std::ptrdiff_t(lhs.index()) - std::ptrdiff_t(rhs.index());
+}
+
+template<typename Line>
+bool operator==(indexed_line_iterator<Line> lhs,
+                indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() == rhs.index();
+}
+
+template<typename Line>
+bool operator!=(indexed_line_iterator<Line> lhs,
+                indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() != rhs.index();
+}
+
+template<typename Line>
+bool operator<(indexed_line_iterator<Line> lhs,
+               indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() < rhs.index();
+}
+
+template<typename Line>
+bool operator<=(indexed_line_iterator<Line> lhs,
+                indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() <= rhs.index();
+}
+
+template<typename Line>
+bool operator>(indexed_line_iterator<Line> lhs,
+               indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() > rhs.index();
+}
+
+template<typename Line>
+bool operator>=(indexed_line_iterator<Line> lhs,
+                indexed_line_iterator<Line> rhs)
+{
+    return lhs.index() >= rhs.index();
+}
+
+enum class line_cover
+{
+    four_connected, // Every cell is orthogonally adjacent to the last.
+    supercover,     // Every cell the segment touches, including corners.
+};
+
+// A line that moves one axis at a time, in the order the segment from
+// the center of 'from' to the center of 'to' crosses cell edges.
+//
+// Scaled by 2 * |dx| * |dy|, the segment crosses its i-th vertical edge
+// at (2i - 1) * |dy| and its j-th horizontal edge at (2j - 1) * |dx|.
+// Seeking counts how many crossings of each kind come before a given
+// index, which is O(1).
+class ortho_line_t
+{
+public:
+    using const_iterator = indexed_line_iterator<ortho_line_t>;
+
+    ortho_line_t() = default;
+
+    ortho_line_t(coord_t from, coord_t to,
+                 line_cover cover = line_cover::four_connected)
+    : m_from(from)
+    , m_step(mapc(to - from, &impl::signum<int2d_t>))
+    , m_d(impl::coord_abs(to - from))
+    {
+        if(cover == line_cover::supercover && m_d.x && m_d.y)
+        {
+            // Corners are crossed only when both reduced deltas are odd.
+            int2d_t const g = impl::gcd(m_d.x, m_d.y);
+            if((m_d.x / g) % 2 && (m_d.y / g) % 2)
+                m_tie_period = m_d.x / g;
+        }
+    }
+
+    coord_t from() const { return m_from; }
+    coord_t to() const
+    {
+        return { m_from.x + m_step.x * m_d.x, m_from.y + m_step.y * m_d.y };
+    }
+
+    std::size_t size() const
+    {
+        return m_d.x + m_d.y + 1 + ties_through(m_d.x);
+    }
+
+    // O(1).
+    coord_t operator[](std::size_t k) const
+    {
+        assert(k < size());
+        if(!m_tie_period)
+            return cell(x_steps(k), k);
+
+        // Supercover: every corner adds one cell, so find the
+        // four-connected index 'q' at or just before 'k'.
+        std::size_t const ties = ties_through(m_d.x);
+        std::size_t const n = m_d.x + m_d.y + 1;
+        std::size_t q = k * n / (n + ties);
+        while(q + 1 < n && super_index(q + 1) <= k)
+            ++q;
+        while(q > 0 && super_index(q) > k)
+            --q;
+        int2d_t const i = x_steps(q);
+        if(super_index(q) == k)
+            return cell(i, q);
+        // The extra cell of a corner: step y before x instead.
+        coord_t const c = cell(i, q);
+        return { c.x - m_step.x, c.y + m_step.y };
+    }
+
+    const_iterator begin() const { return { *this, 0 }; }
+    const_iterator end() const { return { *this, size() }; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+private:
+    // The time, scaled, of the i-th vertical edge crossing (1-based).
+    std::int64_t x_time(std::int64_t i) const { return (2 * i - 1) * m_d.y; }
+
+    // The number of horizontal edge crossings strictly before 'time'.
+    std::int64_t y_before(std::int64_t time) const
+    {
+        return std::min<std::int64_t>(m_d.y, (time + m_d.x - 1)
+                                             / (2 * std::int64_t(m_d.x)));
+    }
+
+    // The four-connected index of the cell just after vertical
+    // crossing 'i'. Ties go to x first.
+    std::int64_t x_rank(std::int64_t i) const
+    {
+        return i ? i + y_before(x_time(i)) : 0;
+    }
+
+    // The number of x steps among the first 'k' four-connected steps.
+    int2d_t x_steps(std::size_t k) const
+    {
+        if(!m_d.x || !m_d.y)
+            return m_d.x ? k : 0;
+        std::int64_t i = std::int64_t(k) * m_d.x / (m_d.x + m_d.y);
+        while(i < m_d.x && x_rank(i + 1) <= std::int64_t(k))
+            ++i;
+        while(i > 0 && x_rank(i) > std::int64_t(k))
+            --i;
+        return i;
+    }
+
+    coord_t cell(int2d_t i, std::size_t k) const
+    {
+        int2d_t const j = k - i;
+        return { m_from.x + i * m_step.x, m_from.y + j * m_step.y };
+    }
+
+    // The number of corners crossed among the first 'i' vertical edges.
+    // Corner 'm' (1-based) is at vertical edge (period * (2m - 1) + 1) / 2.
+    std::size_t ties_through(int2d_t i) const
+    {
+        if(!m_tie_period || i <= 0)
+            return 0;
+        return (2 * i - 1 + m_tie_period) / (2 * m_tie_period);
+    }
+
+    // The supercover index of four-connected cell 'q'.
+    std::size_t super_index(std::size_t q) const
+    {
+        int2d_t const i = x_steps(q);
+        int2d_t const j = q - i;
+        std::size_t ties = ties_through(i);
+        // If the last x step was into a corner, its y step hasn't
+        // happened yet, and neither has the extra cell.
+        if(i > 0 && (2 * i - 1) % m_tie_period == 0
+           && j < y_before(x_time(i)) + 1)
+            --ties;
+        return q + ties;
+    }
+
+    coord_t m_from = { 0, 0 };
+    coord_t m_step = { 0, 0 };
+    coord_t m_d = { 0, 0 };
+    int2d_t m_tie_period = 0; // Nonzero for supercovers that hit corners.
+};
+
+inline ortho_line_t four_connected_line(coord_t from, coord_t to)
+{
+    return ortho_line_t(from, to, line_cover::four_connected);
+}
+
+inline ortho_line_t supercover_line(coord_t from, coord_t to)
+{
+    return ortho_line_t(from, to, line_cover::supercover);
+}
+
+namespace impl
+{
+    template<typename Func>
+    void iterate_ortho_line(coord_t from, coord_t to, bool supercover,
+                            Func& it_func)
+    {
+        coord_t const dir = to - from;
+        coord_t const d = impl::coord_abs(dir);
+        coord_t const s = mapc(dir, &impl::signum<int2d_t>);
+        // Compare the times of the next crossings, scaled as in
+        // 'ortho_line_t'.
+        std::int64_t x_time = d.y;
+        std::int64_t y_time = d.x;
+        it_func(from);
+        for(int2d_t i = 0, j = 0; i < d.x || j < d.y;)
+        {
+            bool const x_first = j == d.y || (i < d.x && x_time <= y_time);
+            if(x_first)
+            {
+                if(supercover && j < d.y && x_time == y_time)
+                {
+                    it_func(coord_t{ from.x + s.x, from.y });
+                    it_func(coord_t{ from.x, from.y + s.y });
+                    from += s;
+                    ++i;
+                    ++j;
+                    x_time += 2 * d.y;
+                    y_time += 2 * d.x;
+                    it_func(from);
+                    continue;
+                }
+                from.x += s.x;
+                ++i;
+                x_time += 2 * d.y;
+            }
+            else
+            {
+                from.y += s.y;
+                ++j;
+                y_time += 2 * d.x;
+            }
+            it_func(from);
+        }
+    }
+} // namespace impl
+
+// Calls 'it_func' with each coordinate of 'four_connected_line(from, to)'.
+template<typename Func>
+void iterate_line4(coord_t from, coord_t to, Func it_func)
+{
+    impl::iterate_ortho_line(from, to, false, it_func);
+}
+
+// Calls 'it_func' with each coordinate of 'supercover_line(from, to)'.
+template<typename Func>
+void iterate_supercover(coord_t from, coord_t to, Func it_func)
+{
+    impl::iterate_ortho_line(from, to, true, it_func);
+}
+
+// An 8-connected line from 'from' to 'to' swept with a cross-section
+// along its minor axis. The cross-section is sized so that the line is
+// about 'width' cells wide measured perpendicular to it, and is centered
+// on the thin line, with the extra cell below or right of it when its
+// length is even.
+class thick_line_t
+{
+public:
+    using const_iterator = indexed_line_iterator<thick_line_t>;
+
+    thick_line_t() = default;
+
+    thick_line_t(coord_t from, coord_t to, int2d_t width)
+    : m_begin(line_state_t::from_to(from, to))
+    , m_length(c_dist(from, to) + 1)
+    , m_steep(impl::is_steep(m_begin.dir))
+    {
+        assert(width > 0);
+        coord_t const d = impl::coord_abs(to - from);
+        int2d_t const major = std::max(d.x, d.y);
+        m_span = major ? std::max<int2d_t>(1, std::lround(
+                             width * std::hypot(d.x, d.y) / major))
+                       : width;
+    }
+
+    // The number of cross-sections.
+    int2d_t length() const { return m_length; }
+
+    // The number of cells in each cross-section.
+    int2d_t span_width() const { return m_span; }
+
+    std::size_t size() const { return std::size_t(m_length) * m_span; }
+
+    // Cross-section 'n', as a rect one cell thick. O(1).
+    rect_t span(int2d_t n) const
+    {
+        assert(n >= 0 && n < m_length);
+        coord_t const c = line_state_t::next(m_begin, n).pos;
+        int2d_t const offset = (m_span - 1) / 2;
+        if(m_steep)
+            return { { c.x - offset, c.y }, { m_span, 1 } };
+        return { { c.x, c.y - offset }, { 1, m_span } };
+    }
+
+    // O(1).
+    coord_t operator[](std::size_t k) const
+    {
+        assert(k < size());
+        rect_t const r = span(k / m_span);
+        int2d_t const m = k % m_span;
+        return m_steep ? coord_t{ r.c.x + m, r.c.y }
+                       : coord_t{ r.c.x, r.c.y + m };
+    }
+
+    const_iterator begin() const { return { *this, 0 }; }
+    const_iterator end() const { return { *this, size() }; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+private:
+    line_state_t m_begin = {};
+    int2d_t m_length = 0;
+    int2d_t m_span = 0;
+    bool m_steep = false;
+};
+
+// Calls 'it_func' with each cross-section of 'thick_line_t(from, to,
+// width)', as rects one cell thick.
+template<typename Func>
+void iterate_thick_line(coord_t from, coord_t to, int2d_t width,
+                        Func it_func)
+{
+    thick_line_t const line(from, to, width);
+    line_state_t state = line_state_t::from_to(from, to);
+    int2d_t const span = line.span_width();
+    int2d_t const offset = (span - 1) / 2;
+    bool const steep = impl::is_steep(state.dir);
+    for(int2d_t n = 0; n < line.length(); ++n, state.advance())
+    {
+        coord_t const c = state.pos;
+        if(steep)
+            it_func(rect_t{ { c.x - offset, c.y }, { span, 1 } });
+        else
+            it_func(rect_t{ { c.x, c.y - offset }, { 1, span } });
+    }
+}
+
+} // namespace i2d
+
+#endif
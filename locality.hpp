@@ -0,0 +1,260 @@
+#ifndef INT2D_LOCALITY_HPP
+#define INT2D_LOCALITY_HPP
+
+// Space-filling curve keys, and sorting of coords into curve order.
+//
+// Coords next to each other along a Morton (Z-order) or Hilbert curve are
+// also near each other on the grid, so visiting a batch of coords in curve
+// order touches grid memory in mostly the same cache lines and pages.
+// Morton keys are cheaper, and Hilbert keys never jump across the grid.
+//
+// Morton keys use BMI2's pdep/pext when __BMI2__ is defined.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "bounds.hpp"
+#include "units.hpp"
+
+namespace i2d {
+
+enum class curve_order { morton, hilbert };
+
+namespace impl
+{
+    constexpr std::uint64_t morton_even = 0x5555555555555555ull;
+
+    // Moves bit 'i' of 'v' to bit '2 * i'.
+    constexpr std::uint64_t morton_spread(std::uint64_t v)
+    {
+        v &= 0xFFFFFFFFull;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & morton_even;
+        return v;
+    }
+
+    // The inverse of 'morton_spread'. Odd bits are ignored.
+    constexpr std::uint32_t morton_compact(std::uint64_t v)
+    {
+        v &= morton_even;
+        v = (v | (v >> 1)) & 0x3333333333333333ull;
+        v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v >> 16)) & 0xFFFFFFFFull;
+        return static_cast<std::uint32_t>(v);
+    }
+
+    inline std::uint64_t morton_key(std::uint32_t x, std::uint32_t y)
+    {
+#ifdef __BMI2__
+        return _pdep_u64(x, morton_even) | _pdep_u64(y, morton_even << 1);
+#else
+        return morton_spread(x) | (morton_spread(y) << 1);
+#endif
+    }
+
+    inline void morton_unkey(std::uint64_t key,
+                             std::uint32_t& x, std::uint32_t& y)
+    {
+#ifdef __BMI2__
+        x = static_cast<std::uint32_t>(_pext_u64(key, morton_even));
+        y = static_cast<std::uint32_t>(_pext_u64(key, morton_even << 1));
+#else
+        x = morton_compact(key);
+        y = morton_compact(key >> 1);
+#endif
+    }
+
+    // Position along a Hilbert curve over [0, 2^bits) squared.
+    // Only the low 'bits' bits of 'x' and 'y' are used.
+    inline std::uint64_t hilbert_key(std::uint32_t x, std::uint32_t y,
+                                     unsigned bits)
+    {
+        std::uint64_t key = 0;
+        for(unsigned i = bits; i-- > 0;)
+        {
+            std::uint32_t const rx = (x >> i) & 1;
+            std::uint32_t const ry = (y >> i) & 1;
+            key |= std::uint64_t((3 * rx) ^ ry) << (2 * i);
+            // Rotate the quadrant. Only the bits below 'i' matter from
+            // here on, so flipping all of them is enough.
+            if(ry == 0)
+            {
+                if(rx == 1)
+                {
+                    x = ~x;
+                    y = ~y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return key;
+    }
+
+    inline void hilbert_unkey(std::uint64_t key, unsigned bits,
+                              std::uint32_t& x, std::uint32_t& y)
+    {
+        x = 0;
+        y = 0;
+        for(unsigned i = 0; i < bits; ++i)
+        {
+            std::uint32_t const s = std::uint32_t(1) << i;
+            std::uint32_t const rx = 1 & std::uint32_t(key >> (2 * i + 1));
+            std::uint32_t const ry = 1 & (std::uint32_t(key >> (2 * i)) ^ rx);
+            if(ry == 0)
+            {
+                if(rx == 1)
+                {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+            x += s * rx;
+            y += s * ry;
+        }
+    }
+
+    // Maps int2d_t to uint32 keeping the order.
+    constexpr std::uint32_t order_bias(int2d_t v)
+    {
+        return std::uint32_t(v) ^ 0x80000000u;
+    }
+
+    constexpr int2d_t order_unbias(std::uint32_t v)
+    {
+        return static_cast<int2d_t>(v ^ 0x80000000u);
+    }
+
+    // Stable LSD radix sort of 'keys' and 'index' together on the low
+    // 'bits' bits of the keys.
+    inline void radix_sort_keys(std::vector<std::uint64_t>& keys,
+                                std::vector<std::uint32_t>& index,
+                                unsigned bits)
+    {
+        constexpr unsigned digit_bits = 8;
+        constexpr std::size_t radix = std::size_t(1) << digit_bits;
+        std::size_t const n = keys.size();
+        std::vector<std::uint64_t> keys2(n);
+        std::vector<std::uint32_t> index2(n);
+        for(unsigned shift = 0; shift < bits; shift += digit_bits)
+        {
+            std::size_t starts[radix] = {};
+            for(std::uint64_t k : keys)
+                ++starts[(k >> shift) & (radix - 1)];
+            std::size_t sum = 0;
+            for(std::size_t& s : starts)
+                sum += std::exchange(s, sum);
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                std::size_t& start = starts[(keys[i] >> shift) & (radix - 1)];
+                keys2[start] = keys[i];
+                index2[start] = index[i];
+                ++start;
+            }
+            keys.swap(keys2);
+            index.swap(index2);
+        }
+    }
+} // namespace impl
+
+// Interleaves the bits of 'crd'. Keys of coords compare in the same order
+// as their positions along the Z curve, negative coords included.
+inline std::uint64_t morton_encode(coord_t crd)
+{
+    return impl::morton_key(impl::order_bias(crd.x), impl::order_bias(crd.y));
+}
+
+inline coord_t morton_decode(std::uint64_t key)
+{
+    std::uint32_t x, y;
+    impl::morton_unkey(key, x, y);
+    return { impl::order_unbias(x), impl::order_unbias(y) };
+}
+
+// The distance of 'crd' along a Hilbert curve filling the square from
+// { 0, 0 } to { 2^bits - 1, 2^bits - 1 }, which must contain 'crd'.
+inline std::uint64_t hilbert_encode(coord_t crd, unsigned bits)
+{
+    assert(bits < 32);
+    assert(crd.x >= 0 && crd.y >= 0);
+    assert((std::uint32_t(crd.x) >> bits) == 0
+           && (std::uint32_t(crd.y) >> bits) == 0);
+    return impl::hilbert_key(crd.x, crd.y, bits);
+}
+
+inline coord_t hilbert_decode(std::uint64_t key, unsigned bits)
+{
+    assert(bits < 32);
+    std::uint32_t x, y;
+    impl::hilbert_unkey(key, bits, x, y);
+    return { static_cast<int2d_t>(x), static_cast<int2d_t>(y) };
+}
+
+// Stably sorts [begin, end) into curve order by the coord 'proj' gives
+// for each element. Keys are taken relative to the bounding box, so the
+// radix sort only makes as many passes as the box's size needs.
+template<typename It, typename Proj>
+void locality_sort(It begin, It end, Proj proj,
+                   curve_order order = curve_order::hilbert)
+{
+    using value_type = typename std::iterator_traits<It>::value_type;
+    std::size_t const n = static_cast<std::size_t>(end - begin);
+    if(n < 2)
+        return;
+
+    std::vector<coord_t> crds(n);
+    for(std::size_t i = 0; i < n; ++i)
+        crds[i] = proj(begin[i]);
+    rect_t const bounds = coord_bounds(crds.data(), n);
+
+    std::uint32_t const extent = std::uint32_t(std::max(bounds.d.w,
+                                                        bounds.d.h)) - 1;
+    unsigned bits = 0;
+    while(bits < 32 && (extent >> bits) != 0)
+        ++bits;
+
+    std::vector<std::uint64_t> keys(n);
+    std::vector<std::uint32_t> index(n);
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        std::uint32_t const x = std::uint32_t(crds[i].x)
+                                - std::uint32_t(bounds.c.x);
+        std::uint32_t const y = std::uint32_t(crds[i].y)
+                                - std::uint32_t(bounds.c.y);
+        keys[i] = order == curve_order::morton ? impl::morton_key(x, y)
+                                               : impl::hilbert_key(x, y, bits);
+        index[i] = static_cast<std::uint32_t>(i);
+    }
+    impl::radix_sort_keys(keys, index, 2 * bits);
+
+    std::vector<value_type> sorted;
+    sorted.reserve(n);
+    for(std::uint32_t i : index)
+        sorted.push_back(std::move(begin[i]));
+    std::move(sorted.begin(), sorted.end(), begin);
+}
+
+// Sorts a range of coords into curve order.
+template<typename It>
+void locality_sort(It begin, It end, curve_order order = curve_order::hilbert)
+{
+    locality_sort(begin, end, [](coord_t crd) { return crd; }, order);
+}
+
+} // namespace i2d
+
+#endif
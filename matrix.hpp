@@ -4,13 +4,16 @@
 // Some very crude matrix types.
 // Functionality is added as-needed; YAGNI!
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 
 #include "geometry.hpp"
 #include "units.hpp"
 
-namespace int2d {
+namespace i2d {
 
 namespace impl
 {
@@ -171,6 +174,139 @@ rect_t transform(imat3<T> mat, rect_t r)
     return rect_from_2_coords(transform(mat, r.c), transform(mat,r.r()));
 }
 
+namespace impl
+{
+    // The shapes of matrix that batch transforms specialize for.
+    enum class mat_kind
+    {
+        translate, // Identity plus a translation.
+        dihedral,  // Mirrors and 180 degree turns, plus a translation.
+        dihedral_swap, // Same as above, but with x and y swapped.
+        general,
+    };
+
+    template<typename T>
+    mat_kind classify(imat3<T> const& m)
+    {
+        auto const unit = [](T t) { return t == 1 || t == -1; };
+        if(m[0][0] == 1 && m[0][1] == 0 && m[1][0] == 0 && m[1][1] == 1)
+            return mat_kind::translate;
+        if(unit(m[0][0]) && m[0][1] == 0 && m[1][0] == 0 && unit(m[1][1]))
+            return mat_kind::dihedral;
+        if(m[0][0] == 0 && unit(m[0][1]) && unit(m[1][0]) && m[1][1] == 0)
+            return mat_kind::dihedral_swap;
+        return mat_kind::general;
+    }
+
+    // Applies the affine part of a matrix to a single coord.
+    // Each kind only does the arithmetic its shape of matrix needs,
+    // which keeps the batch loops branch-free and easy to vectorize.
+    template<mat_kind K>
+    struct affine_kernel
+    {
+        template<typename T>
+        explicit affine_kernel(imat3<T> const& m)
+        : xx(m[0][0]), yx(m[1][0]), tx(m[2][0])
+        , xy(m[0][1]), yy(m[1][1]), ty(m[2][1])
+        {}
+
+        coord_t operator()(coord_t crd) const
+        {
+            switch(K)
+            {
+            case mat_kind::translate:
+                return { crd.x + tx, crd.y + ty };
+            case mat_kind::dihedral:
+                return { xx*crd.x + tx, yy*crd.y + ty };
+            case mat_kind::dihedral_swap:
+                return { yx*crd.y + tx, xy*crd.x + ty };
+            default:
+                return { xx*crd.x + yx*crd.y + tx, xy*crd.x + yy*crd.y + ty };
+            }
+        }
+
+        int2d_t xx, yx, tx;
+        int2d_t xy, yy, ty;
+    };
+
+    template<typename Kernel>
+    void transform_n(Kernel k, coord_t const* in, std::size_t n, coord_t* out)
+    {
+        for(std::size_t i = 0; i != n; ++i)
+            out[i] = k(in[i]);
+    }
+
+    // Same result as 'rect_from_2_coords' on the transformed corners.
+    template<typename Kernel>
+    void transform_n(Kernel k, rect_t const* in, std::size_t n, rect_t* out)
+    {
+        for(std::size_t i = 0; i != n; ++i)
+        {
+            rect_t const r = in[i];
+            coord_t const a = k(r.c);
+            coord_t const b = k(coord_t{ r.c.x + r.d.w - 1,
+                                         r.c.y + r.d.h - 1 });
+            out[i] =
+            {
+                { std::min(a.x, b.x), std::min(a.y, b.y) },
+                { std::abs(a.x - b.x) + 1, std::abs(a.y - b.y) + 1 },
+            };
+        }
+    }
+
+    template<typename T, typename U>
+    void transform_batch(imat3<T> const& mat, U const* in, std::size_t n,
+                         U* out)
+    {
+        switch(classify(mat))
+        {
+        case mat_kind::translate:
+            return transform_n(
+                affine_kernel<mat_kind::translate>(mat), in, n, out);
+        case mat_kind::dihedral:
+            return transform_n(
+                affine_kernel<mat_kind::dihedral>(mat), in, n, out);
+        case mat_kind::dihedral_swap:
+            return transform_n(
+                affine_kernel<mat_kind::dihedral_swap>(mat), in, n, out);
+        default:
+            return transform_n(
+                affine_kernel<mat_kind::general>(mat), in, n, out);
+        }
+    }
+} // namespace impl
+
+// Batch versions of 'transform'.
+// 'out' may be equal to 'first' to transform in place, but the ranges
+// must not otherwise overlap.
+template<typename T>
+coord_t* transform(imat3<T> const& mat, coord_t const* first,
+                   coord_t const* last, coord_t* out)
+{
+    impl::transform_batch(mat, first, last - first, out);
+    return out + (last - first);
+}
+
+template<typename T>
+rect_t* transform(imat3<T> const& mat, rect_t const* first,
+                  rect_t const* last, rect_t* out)
+{
+    impl::transform_batch(mat, first, last - first, out);
+    return out + (last - first);
+}
+
+template<typename T>
+void transform(imat3<T> const& mat, coord_t* first, coord_t* last)
+{
+    transform(mat, first, last, first);
+}
+
+template<typename T>
+void transform(imat3<T> const& mat, rect_t* first, rect_t* last)
+{
+    transform(mat, first, last, first);
+}
+
 template<typename T>
 T determinant(imat3<T> m)
 {
@@ -253,6 +389,22 @@ public:
     template<typename T>
     auto from_parent(T&& t) const { return transform(m_inverse, t); }
 
+    // Batch versions of the above, for arrays of coord_t or rect_t.
+    // 'out' may be equal to 'first' to convert in place.
+    template<typename T>
+    T* to_parent(T const* first, T const* last, T* out) const
+        { return transform(m_mat, first, last, out); }
+    template<typename T>
+    void to_parent(T* first, T* last) const
+        { transform(m_mat, first, last); }
+
+    template<typename T>
+    T* from_parent(T const* first, T const* last, T* out) const
+        { return transform(m_inverse, first, last, out); }
+    template<typename T>
+    void from_parent(T* first, T* last) const
+        { transform(m_inverse, first, last); }
+
     imat3x3 matrix() const { return m_mat; }
     imat3x3 inverse_matrix() const { return m_inverse; }
 private:
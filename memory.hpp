@@ -0,0 +1,225 @@
+#ifndef INT2D_MEMORY_HPP
+#define INT2D_MEMORY_HPP
+
+// Allocation helpers for short-lived grids.
+//
+// 'arena_t' hands out memory by bumping a pointer and frees it all at
+// once with 'reset'. 'grid_pool_t' keeps released grids around so they
+// can be handed out again without allocating.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "grid.hpp"
+#include "units.hpp"
+
+namespace i2d {
+
+// A monotonic arena. Deallocation does nothing; memory is reclaimed
+// all at once by 'reset'.
+class arena_t
+{
+public:
+    explicit arena_t(std::size_t block_size = 1 << 20)
+    : m_block_size(std::max<std::size_t>(block_size, 1))
+    {}
+
+    arena_t(arena_t const&) = delete;
+    arena_t& operator=(arena_t const&) = delete;
+
+    ~arena_t()
+    {
+        for(block_t const& block : m_blocks)
+            ::operator delete(block.data);
+    }
+
+    void* allocate(std::size_t bytes, std::size_t align)
+    {
+        assert(align != 0 && (align & (align - 1)) == 0);
+        while(true)
+        {
+            if(m_current < m_blocks.size())
+            {
+                block_t const& block = m_blocks[m_current];
+                std::uintptr_t const begin =
+                    reinterpret_cast<std::uintptr_t>(block.data);
+                std::uintptr_t const p = (begin + m_used + align - 1)
+                                         & ~std::uintptr_t(align - 1);
+                if(p + bytes <= begin + block.size)
+                {
+                    m_used = p + bytes - begin;
+                    return reinterpret_cast<void*>(p);
+                }
+                if(m_current + 1 < m_blocks.size())
+                {
+                    ++m_current;
+                    m_used = 0;
+                    continue;
+                }
+            }
+            std::size_t const size =
+                std::max(m_block_size, bytes + align);
+            m_blocks.push_back({ static_cast<char*>(::operator new(size)),
+                                 size });
+            m_current = m_blocks.size() - 1;
+            m_used = 0;
+        }
+    }
+
+    // Makes all memory available again, invalidating everything that was
+    // allocated. If the last cycle needed more than one block they are
+    // merged into one, so that a steady workload stops allocating.
+    void reset()
+    {
+        if(m_blocks.size() > 1)
+        {
+            std::size_t const total = capacity();
+            for(block_t const& block : m_blocks)
+                ::operator delete(block.data);
+            m_blocks.clear();
+            m_blocks.push_back({ static_cast<char*>(::operator new(total)),
+                                 total });
+        }
+        m_current = 0;
+        m_used = 0;
+    }
+
+    // Total bytes owned by the arena.
+    std::size_t capacity() const
+    {
+        std::size_t total = 0;
+        for(block_t const& block : m_blocks)
+            total += block.size;
+        return total;
+    }
+private:
+    struct block_t
+    {
+        char* data;
+        std::size_t size;
+    };
+
+    std::size_t m_block_size;
+    std::vector<block_t> m_blocks;
+    std::size_t m_current = 0;
+    std::size_t m_used = 0;
+};
+
+// A standard allocator that takes its memory from an 'arena_t'.
+// Containers keep the allocator (and thus the arena) when they are
+// copied, moved, or swapped.
+template<typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit arena_allocator(arena_t& arena) noexcept
+    : m_arena(&arena)
+    {}
+
+    template<typename U>
+    arena_allocator(arena_allocator<U> const& other) noexcept
+    : m_arena(other.arena())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, std::size_t) noexcept {}
+
+    arena_t* arena() const { return m_arena; }
+private:
+    arena_t* m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(arena_allocator<T> const& lhs, arena_allocator<U> const& rhs)
+{
+    return lhs.arena() == rhs.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(arena_allocator<T> const& lhs, arena_allocator<U> const& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template<typename T>
+using arena_grid_t = grid_t<T, arena_allocator<T> >;
+
+// Recycles grids of a given element type, keyed by their dimensions.
+// Grids handed out by 'acquire' hold whatever values they held when
+// they were released, unless a fill value is given.
+// Once every dimension in use has been released at least once,
+// acquiring and releasing does not allocate.
+// If 'A' allocates from an arena, clear the pool before resetting the arena.
+template<typename T, class A = std::allocator<T> >
+class grid_pool_t
+{
+public:
+    using grid_type = grid_t<T, A>;
+    using allocator_type = A;
+
+    grid_pool_t()
+    : grid_pool_t(A())
+    {}
+
+    explicit grid_pool_t(A const& alloc)
+    : m_alloc(alloc)
+    {}
+
+    grid_pool_t(grid_pool_t const&) = delete;
+    grid_pool_t& operator=(grid_pool_t const&) = delete;
+
+    grid_type acquire(dimen_t dim)
+    {
+        auto it = m_free.find(dim);
+        if(it == m_free.end() || it->second.empty())
+            return grid_type(dim, m_alloc);
+        grid_type grid = std::move(it->second.back());
+        it->second.pop_back();
+        return grid;
+    }
+
+    grid_type acquire(dimen_t dim, T const& fill)
+    {
+        grid_type grid = acquire(dim);
+        grid.fill(fill);
+        return grid;
+    }
+
+    // Returns a grid to the pool. It must have been made with an
+    // allocator equal to the pool's.
+    void release(grid_type&& grid)
+    {
+        assert(grid.get_allocator() == m_alloc);
+        if(grid.size() == 0)
+            return;
+        m_free[grid.dimen()].push_back(std::move(grid));
+    }
+
+    // Frees every grid held by the pool.
+    void clear() { m_free.clear(); }
+
+    allocator_type get_allocator() const { return m_alloc; }
+private:
+    A m_alloc;
+    std::map<dimen_t, std::vector<grid_type> > m_free;
+};
+
+} // namespace i2d
+
+#endif
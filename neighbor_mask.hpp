@@ -0,0 +1,283 @@
+#ifndef INT2D_NEIGHBOR_MASK_HPP
+#define INT2D_NEIGHBOR_MASK_HPP
+
+// Per-cell masks of which neighbors can be moved to, using the DIR_FLAG
+// bits from units.hpp. Searches can then iterate a cell's neighbors with
+// a single load and a count-trailing-zeros per neighbor, instead of
+// bounds checking and testing all 8.
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "parallel.hpp"
+#include "units.hpp"
+
+namespace i2d {
+
+// When a diagonal step is allowed. The "sides" of a diagonal step are
+// the two cells orthogonally adjacent to both ends.
+enum class diagonal_rule
+{
+    none,          // Never; the masks are 4-connected.
+    allow,         // Whenever the destination is passable.
+    no_squeeze,    // If at least one side is passable.
+    no_corner_cut, // If both sides are passable.
+};
+
+namespace impl
+{
+    template<diagonal_rule Rule>
+    constexpr std::uint8_t diagonal_sides(std::uint8_t a, std::uint8_t b)
+    {
+        return (Rule == diagonal_rule::none ? 0
+                : Rule == diagonal_rule::allow ? 1
+                : Rule == diagonal_rule::no_squeeze ? (a | b)
+                : (a & b));
+    }
+
+    // 'up', 'mid', and 'down' are rows of 0/1 passability with one cell
+    // of padding on each side, already offset past the padding.
+    // Everything is plain byte arithmetic so the loop vectorizes.
+    template<diagonal_rule Rule>
+    void neighbor_mask_row(std::uint8_t const* up, std::uint8_t const* mid,
+                           std::uint8_t const* down, int2d_t w,
+                           std::uint8_t* out)
+    {
+        for(int2d_t x = 0; x < w; ++x)
+        {
+            std::uint8_t const e = mid[x + 1];
+            std::uint8_t const s = down[x];
+            std::uint8_t const wst = mid[x - 1];
+            std::uint8_t const n = up[x];
+            std::uint8_t const mask =
+                (e << DIR_E)
+                | (s << DIR_S)
+                | (wst << DIR_W)
+                | (n << DIR_N)
+                | ((down[x + 1] & diagonal_sides<Rule>(e, s)) << DIR_SE)
+                | ((down[x - 1] & diagonal_sides<Rule>(wst, s)) << DIR_SW)
+                | ((up[x - 1] & diagonal_sides<Rule>(wst, n)) << DIR_NW)
+                | ((up[x + 1] & diagonal_sides<Rule>(e, n)) << DIR_NE);
+            out[x] = mask & -mid[x];
+        }
+    }
+
+    template<diagonal_rule Rule>
+    void neighbor_mask_rows(std::vector<std::uint8_t> const& padded,
+                            dimen_t dim, std::uint8_t* out,
+                            parallel_opts_t opts)
+    {
+        std::size_t const stride = dim.w + 2;
+        parallel_bands(0, dim.h, [&](int2d_t b, int2d_t e)
+        {
+            for(int2d_t y = b; y < e; ++y)
+            {
+                std::uint8_t const* mid = padded.data() + (y + 1) * stride + 1;
+                neighbor_mask_row<Rule>(mid - stride, mid, mid + stride,
+                                        dim.w, out + y * dim.w);
+            }
+        }, opts);
+    }
+} // namespace impl
+
+// Returns a grid where each cell holds the DIR_FLAG bits of the
+// neighbors that can be moved to from it. Cells outside 'grid' are
+// impassable, as are cells for which 'passable(value)' is false.
+// Impassable cells get a mask of 0.
+template<typename Grid, typename Pred>
+grid_t<std::uint8_t> neighbor_masks(
+    Grid const& grid, Pred passable,
+    diagonal_rule rule = diagonal_rule::no_corner_cut,
+    parallel_opts_t opts = {})
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    dimen_t const dim = grid.dimen();
+    grid_t<std::uint8_t> ret(dim, uninitialized);
+
+    std::size_t const stride = dim.w + 2;
+    std::vector<std::uint8_t> padded(stride * (dim.h + 2), 0);
+    for(coord_t crd : dimen_range(dim))
+        padded[(crd.y + 1) * stride + crd.x + 1] = passable(grid[crd]) ? 1 : 0;
+
+    switch(rule)
+    {
+    case diagonal_rule::none:
+        impl::neighbor_mask_rows<diagonal_rule::none>(
+            padded, dim, ret.data(), opts);
+        break;
+    case diagonal_rule::allow:
+        impl::neighbor_mask_rows<diagonal_rule::allow>(
+            padded, dim, ret.data(), opts);
+        break;
+    case diagonal_rule::no_squeeze:
+        impl::neighbor_mask_rows<diagonal_rule::no_squeeze>(
+            padded, dim, ret.data(), opts);
+        break;
+    case diagonal_rule::no_corner_cut:
+        impl::neighbor_mask_rows<diagonal_rule::no_corner_cut>(
+            padded, dim, ret.data(), opts);
+        break;
+    }
+    return ret;
+}
+
+// Same as above, treating cells that convert to 'true' as passable.
+template<typename Grid>
+grid_t<std::uint8_t> neighbor_masks(
+    Grid const& grid,
+    diagonal_rule rule = diagonal_rule::no_corner_cut,
+    parallel_opts_t opts = {})
+{
+    using value_type = typename Grid::value_type;
+    return neighbor_masks(grid,
+                          [](value_type const& v) { return bool(v); },
+                          rule, opts);
+}
+
+// Iterates the directions set in a DIR_FLAG mask, in dir_t order.
+class dir_mask_iterator
+: public std::iterator<std::forward_iterator_tag, dir_t const>
+{
+public:
+    dir_mask_iterator() = default;
+    explicit dir_mask_iterator(unsigned mask) : m_mask(mask) {}
+
+    dir_t operator*() const
+    {
+        assert(m_mask);
+        return dir_t(__builtin_ctz(m_mask));
+    }
+
+    dir_mask_iterator& operator++()
+    {
+        m_mask &= m_mask - 1;
+        return *this;
+    }
+
+    dir_mask_iterator operator++(int)
+    {
+        dir_mask_iterator ret = *this;
+        ++(*this);
+        return ret;
+    }
+
+    unsigned mask() const { return m_mask; }
+private:
+    unsigned m_mask = 0;
+};
+
+inline bool operator==(dir_mask_iterator lhs, dir_mask_iterator rhs)
+{
+    return lhs.mask() == rhs.mask();
+}
+
+inline bool operator!=(dir_mask_iterator lhs, dir_mask_iterator rhs)
+{
+    return !(lhs == rhs);
+}
+
+class dir_mask_range
+{
+public:
+    using const_iterator = dir_mask_iterator;
+
+    dir_mask_range() = default;
+    explicit dir_mask_range(unsigned mask) : m_mask(mask) {}
+
+    dir_mask_iterator begin() const { return dir_mask_iterator(m_mask); }
+    dir_mask_iterator end() const { return dir_mask_iterator(); }
+
+    dir_mask_iterator cbegin() const { return begin(); }
+    dir_mask_iterator cend() const { return end(); }
+
+    unsigned mask() const { return m_mask; }
+private:
+    unsigned m_mask = 0;
+};
+
+// Iterates the neighbors of 'center' whose DIR_FLAG bits are in 'mask'.
+class masked_neighbor_iterator
+: public std::iterator<std::forward_iterator_tag, coord_t const>
+{
+public:
+    masked_neighbor_iterator() = default;
+    masked_neighbor_iterator(coord_t center, unsigned mask)
+    : m_center(center)
+    , m_it(mask)
+    {}
+
+    coord_t operator*() const { return m_center + dir_range[*m_it]; }
+
+    masked_neighbor_iterator& operator++()
+    {
+        ++m_it;
+        return *this;
+    }
+
+    masked_neighbor_iterator operator++(int)
+    {
+        masked_neighbor_iterator ret = *this;
+        ++(*this);
+        return ret;
+    }
+
+    // The direction of the current neighbor.
+    dir_t dir() const { return *m_it; }
+
+    coord_t center() const { return m_center; }
+    unsigned mask() const { return m_it.mask(); }
+private:
+    coord_t m_center = { 0, 0 };
+    dir_mask_iterator m_it;
+};
+
+inline bool operator==(masked_neighbor_iterator lhs,
+                       masked_neighbor_iterator rhs)
+{
+    assert(lhs.center() == rhs.center());
+    return lhs.mask() == rhs.mask();
+}
+
+inline bool operator!=(masked_neighbor_iterator lhs,
+                       masked_neighbor_iterator rhs)
+{
+    return !(lhs == rhs);
+}
+
+class masked_neighbor_range
+{
+public:
+    using const_iterator = masked_neighbor_iterator;
+
+    masked_neighbor_range() = default;
+    masked_neighbor_range(coord_t center, unsigned mask)
+    : m_center(center)
+    , m_mask(mask)
+    {}
+
+    masked_neighbor_iterator begin() const { return { m_center, m_mask }; }
+    masked_neighbor_iterator end() const { return { m_center, 0 }; }
+
+    masked_neighbor_iterator cbegin() const { return begin(); }
+    masked_neighbor_iterator cend() const { return end(); }
+private:
+    coord_t m_center = { 0, 0 };
+    unsigned m_mask = 0;
+};
+
+// The neighbors that can be moved to from 'crd', according to a grid
+// returned by 'neighbor_masks'.
+template<typename Grid>
+masked_neighbor_range passable_neighbors(Grid const& masks, coord_t crd)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    return masked_neighbor_range(crd, masks[crd]);
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,590 @@
+#ifndef INT2D_PACKER_HPP
+#define INT2D_PACKER_HPP
+
+// Rectangle packers for texture atlases, room placement, etc.
+//
+// Both packers place rects into a fixed-size bin one at a time and can
+// optionally rotate them by 90 degrees. A placed rect whose dimen differs
+// from the one requested was rotated.
+//
+// maxrects_packer_t tracks every maximal free rect, giving the tightest
+// packings. Free rects are kept in a bucket grid so that splitting and
+// pruning them only looks at nearby rects.
+//
+// skyline_packer_t only tracks the upper outline of what's been placed,
+// so it's much faster but wastes space under overhangs.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+// How maxrects_packer_t picks among the free rects a rect fits in.
+enum class maxrects_rule
+{
+    best_short_side_fit, // Minimize the smaller leftover side.
+    bottom_left,         // Minimize the bottom edge, then x.
+};
+
+class maxrects_packer_t
+{
+public:
+    explicit maxrects_packer_t(
+        dimen_t bin, bool allow_rotation = false,
+        maxrects_rule rule = maxrects_rule::best_short_side_fit)
+    : m_rotate(allow_rotation)
+    , m_rule(rule)
+    {
+        reset(bin);
+    }
+
+    // Empties the bin and changes its size.
+    void reset(dimen_t bin)
+    {
+        m_bin = bin;
+        m_used = 0;
+        m_min_side = 1;
+        m_slots.clear();
+        m_live.clear();
+        m_unused_ids.clear();
+        m_large.clear();
+        m_by_w.assign(std::max(0, bin.w) + 1, {});
+        m_by_h.assign(std::max(0, bin.h) + 1, {});
+
+        // Aim for at most 64 cells per side.
+        int2d_t const side = std::max(bin.w, bin.h);
+        m_cell_size = std::max<int2d_t>(1, (side + 63) / 64);
+        m_cells = { (bin.w + m_cell_size - 1) / m_cell_size,
+                    (bin.h + m_cell_size - 1) / m_cell_size };
+        m_buckets.assign(std::max(0, area(m_cells)), {});
+
+        if(bin.w > 0 && bin.h > 0)
+            add_free(to_rect(bin));
+    }
+
+    dimen_t dimen() const { return m_bin; }
+
+    // The total area of the rects placed so far.
+    std::size_t used_area() const { return m_used; }
+
+    std::size_t free_rect_count() const { return m_live.size(); }
+
+    // Free rects narrower or shorter than 'side' are discarded, as they
+    // can't hold anything. Packing mostly small rects leaves behind many
+    // thin slivers, so this can make insertion several times faster.
+    // Lasts until the next 'reset'.
+    void set_min_side(int2d_t side)
+    {
+        m_min_side = side;
+        for(std::size_t i = 0; i < m_live.size();)
+        {
+            rect_t const& r = m_slots[m_live[i]].r;
+            if(r.d.w < side || r.d.h < side)
+                remove_free(m_live[i]);
+            else
+                ++i;
+        }
+    }
+
+    int2d_t min_side() const { return m_min_side; }
+
+    // Places a rect of 'dim', storing where in 'placed'.
+    // Returns false if it doesn't fit anywhere.
+    bool insert(dimen_t dim, rect_t& placed)
+    {
+        if(dim.w <= 0 || dim.h <= 0)
+            return false;
+
+        bool found = false;
+        score_t best = {};
+        if(m_rule == maxrects_rule::best_short_side_fit)
+            found = find_short_side_fit(dim, placed);
+        if(!found)
+        {
+            for(std::uint32_t id : m_live)
+            {
+                rect_t const& f = m_slots[id].r;
+                try_fit(f, dim, found, best, placed);
+                if(m_rotate && dim.w != dim.h)
+                    try_fit(f, rotate(dim, 1), found, best, placed);
+            }
+        }
+        if(!found)
+            return false;
+
+        place(placed);
+        m_used += static_cast<std::size_t>(area(placed));
+        return true;
+    }
+private:
+    struct score_t
+    {
+        std::int64_t primary;
+        std::int64_t secondary;
+    };
+
+    static bool better(score_t a, score_t b)
+    {
+        return (a.primary < b.primary
+                || (a.primary == b.primary && a.secondary < b.secondary));
+    }
+
+    struct slot_t
+    {
+        rect_t r;
+        std::uint32_t gen;      // Bumped whenever the slot is freed.
+        std::uint32_t live_pos; // Index in 'm_live'.
+        std::uint32_t stamp;    // Used to visit each slot once per query.
+    };
+
+    // Spatial index entries go stale when the slot's 'gen' changes,
+    // and are dropped lazily the next time they're visited.
+    struct entry_t
+    {
+        std::uint32_t id;
+        std::uint32_t gen;
+    };
+
+    struct size_entry_t
+    {
+        int2d_t other; // The rect's other side.
+        std::uint32_t id;
+    };
+
+    friend bool operator<(size_entry_t a, size_entry_t b)
+    {
+        return a.other < b.other || (a.other == b.other && a.id < b.id);
+    }
+
+    using size_list_t = std::vector<size_entry_t>;
+
+    static void size_insert(size_list_t& list, size_entry_t e)
+    {
+        list.insert(std::lower_bound(list.begin(), list.end(), e), e);
+    }
+
+    static void size_erase(size_list_t& list, size_entry_t e)
+    {
+        auto const it = std::lower_bound(list.begin(), list.end(), e);
+        assert(it != list.end() && it->id == e.id);
+        list.erase(it);
+    }
+
+    // Rects covering more cells than this go in 'm_large' instead.
+    enum { max_cells = 16 };
+
+    void try_fit(rect_t const& f, dimen_t dim, bool& found, score_t& best,
+                 rect_t& placed) const
+    {
+        if(dim.w > f.d.w || dim.h > f.d.h)
+            return;
+        std::int64_t const lw = f.d.w - dim.w;
+        std::int64_t const lh = f.d.h - dim.h;
+        score_t s;
+        switch(m_rule)
+        {
+        case maxrects_rule::best_short_side_fit:
+            s = { std::min(lw, lh), std::max(lw, lh) };
+            break;
+        case maxrects_rule::bottom_left:
+        default:
+            s = { f.c.y + dim.h, f.c.x };
+            break;
+        }
+        if(!found || better(s, best))
+        {
+            found = true;
+            best = s;
+            placed = { f.c, dim };
+        }
+    }
+
+    // Free rects are also indexed by their exact width and height, each
+    // list sorted by the other side. A rect with a short side leftover
+    // of 's' has either width 'w + s' or height 'h + s', so the best
+    // short side fit is found by trying s = 0, 1, 2... in turn.
+    // That stops being worth it once 's' gets large relative to the
+    // number of free rects, at which point this gives up and the caller
+    // scans them all instead.
+    bool find_short_side_fit(dimen_t dim, rect_t& placed) const
+    {
+        bool const rotated = m_rotate && dim.w != dim.h;
+        int2d_t const max_s = std::min<std::size_t>(
+            std::max(m_bin.w, m_bin.h), m_live.size() / 4);
+        for(int2d_t s = 0; s <= max_s; ++s)
+        {
+            bool found = false;
+            int2d_t best = 0; // The long side leftover.
+            auto const try_side = [&](size_list_t const& list,
+                                      int2d_t min_other, int2d_t other_side,
+                                      dimen_t d)
+            {
+                auto const it = std::lower_bound(
+                    list.begin(), list.end(), size_entry_t{ min_other, 0 });
+                if(it == list.end())
+                    return;
+                int2d_t const left = it->other - other_side;
+                if(!found || left < best)
+                {
+                    found = true;
+                    best = left;
+                    placed = { m_slots[it->id].r.c, d };
+                }
+            };
+            auto const try_dim = [&](dimen_t d)
+            {
+                if(d.w + s <= m_bin.w)
+                    try_side(m_by_w[d.w + s], d.h + s, d.h, d);
+                if(d.h + s <= m_bin.h)
+                    try_side(m_by_h[d.h + s], d.w + s, d.w, d);
+            };
+            try_dim(dim);
+            if(rotated)
+                try_dim(rotate(dim, 1));
+            if(found)
+                return true;
+        }
+        return false;
+    }
+
+    rect_t cell_span(rect_t r) const
+    {
+        coord_t const c1 = { r.c.x / m_cell_size, r.c.y / m_cell_size };
+        coord_t const c2 = { (r.ex() - 1) / m_cell_size,
+                             (r.ey() - 1) / m_cell_size };
+        return rect_from_2_coords(c1, c2);
+    }
+
+    void add_free(rect_t r)
+    {
+        std::uint32_t id;
+        if(m_unused_ids.empty())
+        {
+            id = m_slots.size();
+            m_slots.push_back({ r, 0, 0, 0 });
+        }
+        else
+        {
+            id = m_unused_ids.back();
+            m_unused_ids.pop_back();
+            m_slots[id].r = r;
+        }
+        m_slots[id].live_pos = m_live.size();
+        m_live.push_back(id);
+        size_insert(m_by_w[r.d.w], { r.d.h, id });
+        size_insert(m_by_h[r.d.h], { r.d.w, id });
+
+        entry_t const entry = { id, m_slots[id].gen };
+        rect_t const span = cell_span(r);
+        if(area(span) > max_cells)
+            m_large.push_back(entry);
+        else
+            for(coord_t cell : rect_range(span))
+                m_buckets[grid_index(m_cells, cell)].push_back(entry);
+    }
+
+    void remove_free(std::uint32_t id)
+    {
+        slot_t& slot = m_slots[id];
+        ++slot.gen;
+        size_erase(m_by_w[slot.r.d.w], { slot.r.d.h, id });
+        size_erase(m_by_h[slot.r.d.h], { slot.r.d.w, id });
+        std::uint32_t const moved = m_live.back();
+        m_live[slot.live_pos] = moved;
+        m_slots[moved].live_pos = slot.live_pos;
+        m_live.pop_back();
+        m_unused_ids.push_back(id);
+    }
+
+    // Calls 'func(id)' once for every free rect that may overlap 'r'.
+    template<typename Func>
+    void query(rect_t r, Func func)
+    {
+        if(++m_stamp == 0)
+        {
+            for(slot_t& slot : m_slots)
+                slot.stamp = 0;
+            m_stamp = 1;
+        }
+        auto const visit = [&](std::vector<entry_t>& entries)
+        {
+            std::size_t out = 0;
+            for(std::size_t i = 0; i != entries.size(); ++i)
+            {
+                entry_t const e = entries[i];
+                slot_t& slot = m_slots[e.id];
+                if(slot.gen != e.gen)
+                    continue;
+                entries[out++] = e;
+                if(slot.stamp != m_stamp)
+                {
+                    slot.stamp = m_stamp;
+                    func(e.id);
+                }
+            }
+            entries.resize(out);
+        };
+        visit(m_large);
+        for(coord_t cell : rect_range(cell_span(r)))
+            visit(m_buckets[grid_index(m_cells, cell)]);
+    }
+
+    static bool contains(rect_t const& outer, rect_t const& inner)
+    {
+        return in_bounds(inner, outer);
+    }
+
+    // Splits every free rect overlapping 'used' into the maximal rects
+    // around it, then drops any that are contained in another.
+    void place(rect_t used)
+    {
+        m_hits.clear();
+        query(used, [&](std::uint32_t id)
+        {
+            if(overlapping(m_slots[id].r, used))
+                m_hits.push_back(id);
+        });
+
+        m_pieces.clear();
+        for(std::uint32_t id : m_hits)
+        {
+            rect_t const f = m_slots[id].r;
+            remove_free(id);
+            if(used.c.x > f.c.x)
+                m_pieces.push_back({ f.c, { used.c.x - f.c.x, f.d.h } });
+            if(used.ex() < f.ex())
+                m_pieces.push_back({ { used.ex(), f.c.y },
+                                     { f.ex() - used.ex(), f.d.h } });
+            if(used.c.y > f.c.y)
+                m_pieces.push_back({ f.c, { f.d.w, used.c.y - f.c.y } });
+            if(used.ey() < f.ey())
+                m_pieces.push_back({ { f.c.x, used.ey() },
+                                     { f.d.w, f.ey() - used.ey() } });
+        }
+
+        // The remaining free rects were never contained in the ones just
+        // split, so they can't be contained in the pieces either. Only
+        // the pieces themselves need checking.
+        for(std::size_t i = 0; i != m_pieces.size(); ++i)
+        {
+            rect_t const n = m_pieces[i];
+            bool redundant = false;
+            for(std::size_t j = 0; j != m_pieces.size() && !redundant; ++j)
+            {
+                if(j != i && contains(m_pieces[j], n)
+                   && (m_pieces[j] != n || j < i))
+                    redundant = true;
+            }
+            if(!redundant)
+            {
+                query({ n.c, { 1, 1 } }, [&](std::uint32_t id)
+                {
+                    if(contains(m_slots[id].r, n))
+                        redundant = true;
+                });
+            }
+            if(!redundant && n.d.w >= m_min_side && n.d.h >= m_min_side)
+                m_kept.push_back(n);
+        }
+        for(rect_t const& r : m_kept)
+            add_free(r);
+        m_kept.clear();
+    }
+
+    bool m_rotate;
+    maxrects_rule m_rule;
+    dimen_t m_bin = { 0, 0 };
+    int2d_t m_min_side = 1;
+    std::size_t m_used = 0;
+
+    std::vector<slot_t> m_slots;
+    std::vector<std::uint32_t> m_live; // Ids of the current free rects.
+    std::vector<std::uint32_t> m_unused_ids;
+    std::vector<size_list_t> m_by_w; // Free rects by width.
+    std::vector<size_list_t> m_by_h; // Free rects by height.
+
+    int2d_t m_cell_size = 1;
+    dimen_t m_cells = { 0, 0 };
+    std::vector<std::vector<entry_t> > m_buckets;
+    std::vector<entry_t> m_large;
+    std::uint32_t m_stamp = 0;
+
+    // Scratch space for 'place'.
+    std::vector<std::uint32_t> m_hits;
+    std::vector<rect_t> m_pieces;
+    std::vector<rect_t> m_kept;
+};
+
+class skyline_packer_t
+{
+public:
+    explicit skyline_packer_t(dimen_t bin, bool allow_rotation = false)
+    : m_rotate(allow_rotation)
+    {
+        reset(bin);
+    }
+
+    // Empties the bin and changes its size.
+    void reset(dimen_t bin)
+    {
+        m_bin = bin;
+        m_used = 0;
+        m_skyline.clear();
+        if(bin.w > 0 && bin.h > 0)
+            m_skyline.push_back({ 0, 0, bin.w });
+    }
+
+    dimen_t dimen() const { return m_bin; }
+
+    // The total area of the rects placed so far.
+    std::size_t used_area() const { return m_used; }
+
+    // Places a rect of 'dim' as low as possible, storing where in
+    // 'placed'. Returns false if it doesn't fit anywhere.
+    bool insert(dimen_t dim, rect_t& placed)
+    {
+        if(dim.w <= 0 || dim.h <= 0)
+            return false;
+
+        bool found = false;
+        int2d_t best_bottom = 0;
+        int2d_t best_width = 0;
+        std::size_t best_i = 0;
+        auto const try_fit = [&](std::size_t i, dimen_t d)
+        {
+            int2d_t y;
+            if(!fit(i, d, y))
+                return;
+            int2d_t const bottom = y + d.h;
+            if(!found || bottom < best_bottom
+               || (bottom == best_bottom && m_skyline[i].w < best_width))
+            {
+                found = true;
+                best_bottom = bottom;
+                best_width = m_skyline[i].w;
+                best_i = i;
+                placed = { { m_skyline[i].x, y }, d };
+            }
+        };
+        for(std::size_t i = 0; i != m_skyline.size(); ++i)
+        {
+            try_fit(i, dim);
+            if(m_rotate && dim.w != dim.h)
+                try_fit(i, rotate(dim, 1));
+        }
+        if(!found)
+            return false;
+
+        add_level(best_i, placed);
+        m_used += static_cast<std::size_t>(area(placed));
+        return true;
+    }
+private:
+    // A horizontal stretch of the outline. Everything above 'y' is used.
+    struct segment_t
+    {
+        int2d_t x;
+        int2d_t y;
+        int2d_t w;
+    };
+
+    // Whether 'dim' fits with its left edge at segment 'i', storing the
+    // y it would be placed at.
+    bool fit(std::size_t i, dimen_t dim, int2d_t& y) const
+    {
+        if(m_skyline[i].x + dim.w > m_bin.w)
+            return false;
+        y = 0;
+        int2d_t left = dim.w;
+        for(std::size_t j = i; left > 0; ++j)
+        {
+            assert(j < m_skyline.size());
+            y = std::max(y, m_skyline[j].y);
+            if(y + dim.h > m_bin.h)
+                return false;
+            left -= m_skyline[j].w;
+        }
+        return true;
+    }
+
+    void add_level(std::size_t i, rect_t r)
+    {
+        m_skyline.insert(m_skyline.begin() + i, { r.c.x, r.ey(), r.d.w });
+
+        // Trim the segments now underneath the new one.
+        int2d_t const end = r.ex();
+        std::size_t j = i + 1;
+        std::size_t erase_end = j;
+        while(erase_end != m_skyline.size() && m_skyline[erase_end].x < end)
+        {
+            segment_t& s = m_skyline[erase_end];
+            int2d_t const s_end = s.x + s.w;
+            if(s_end > end)
+            {
+                s.w = s_end - end;
+                s.x = end;
+                break;
+            }
+            ++erase_end;
+        }
+        m_skyline.erase(m_skyline.begin() + j, m_skyline.begin() + erase_end);
+
+        // Merge with neighbors at the same height.
+        if(j < m_skyline.size() && m_skyline[j].y == m_skyline[i].y)
+        {
+            m_skyline[i].w += m_skyline[j].w;
+            m_skyline.erase(m_skyline.begin() + j);
+        }
+        if(i > 0 && m_skyline[i - 1].y == m_skyline[i].y)
+        {
+            m_skyline[i - 1].w += m_skyline[i].w;
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+    }
+
+    bool m_rotate;
+    dimen_t m_bin = { 0, 0 };
+    std::size_t m_used = 0;
+    std::vector<segment_t> m_skyline; // Sorted by x, covering the bin.
+};
+
+// Packs every dimen in [begin, end), largest first, which packs much
+// tighter than inserting in arbitrary order. Returns the placements in
+// the original order. Rects that didn't fit get a dimen of zero.
+// If nothing smaller will be packed afterwards, calling 'set_min_side'
+// first with the batch's smallest side can speed this up a lot.
+template<typename Packer, typename It>
+std::vector<rect_t> pack_sorted(Packer& packer, It begin, It end)
+{
+    std::vector<dimen_t> const dims(begin, end);
+    std::vector<std::size_t> order(dims.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&dims](std::size_t a, std::size_t b)
+        {
+            dimen_t const da = dims[a];
+            dimen_t const db = dims[b];
+            int2d_t const la = std::max(da.w, da.h);
+            int2d_t const lb = std::max(db.w, db.h);
+            if(la != lb)
+                return la > lb;
+            return std::min(da.w, da.h) > std::min(db.w, db.h);
+        });
+
+    std::vector<rect_t> ret(dims.size(), rect_t{ { 0, 0 }, { 0, 0 } });
+    for(std::size_t i : order)
+        if(!packer.insert(dims[i], ret[i]))
+            ret[i] = { { 0, 0 }, { 0, 0 } };
+    return ret;
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef INT2D_PARALLEL_HPP
+#define INT2D_PARALLEL_HPP
+
+// Minimal helpers for splitting row-oriented work across threads.
+// Algorithms elsewhere in the library use these so that they all share
+// the same splitting behavior.
+// NOTE: Requires linking with the platform's thread library (-pthread).
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "units.hpp"
+
+namespace i2d {
+
+// How 'parallel_bands' is allowed to split work.
+struct parallel_opts_t
+{
+    // Bands smaller than this are never split off onto their own thread.
+    int2d_t min_band = 64;
+
+    // 0 means use std::thread::hardware_concurrency().
+    // 1 forces everything to run on the calling thread.
+    unsigned max_threads = 0;
+};
+
+// Splits [begin, end) into contiguous bands and calls 'func(b, e)' once
+// for each band [b, e), using one thread per band.
+// The last band runs on the calling thread.
+// If any call throws, the first exception is rethrown after all bands
+// have finished.
+template<typename Func>
+void parallel_bands(int2d_t begin, int2d_t end, Func func,
+                    parallel_opts_t opts = {})
+{
+    if(end <= begin)
+        return;
+
+    unsigned threads = opts.max_threads;
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    int2d_t const length = end - begin;
+    int2d_t const min_band = std::max<int2d_t>(1, opts.min_band);
+    threads = std::min<unsigned>(threads, std::max(1, length / min_band));
+
+    if(threads <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+
+    auto const band_begin = [&](unsigned i)
+    {
+        return begin + static_cast<int2d_t>(
+            static_cast<long long>(length) * i / threads);
+    };
+
+    auto const run = [&](unsigned i)
+    {
+        try
+        {
+            func(band_begin(i), band_begin(i + 1));
+        }
+        catch(...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    for(unsigned i = 0; i + 1 < threads; ++i)
+        pool.emplace_back(run, i);
+    run(threads - 1);
+
+    for(std::thread& thread : pool)
+        thread.join();
+
+    for(std::exception_ptr const& error : errors)
+        if(error)
+            std::rethrow_exception(error);
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef INT2D_POLYGON_HPP
+#define INT2D_POLYGON_HPP
+
+// Polygon and triangle rasterization.
+//
+// A cell is inside when its coordinate is inside the shape traced through
+// the vertex coordinates. Cells exactly on the boundary follow the top-left
+// rule: they belong to the shape only on its top and left edges. Shapes
+// sharing an edge therefore never both cover a cell along it, and never
+// leave a gap. Both rasterizers below give identical results for the same
+// triangle.
+//
+// Polygons are filled a row at a time from an active edge table, with edge
+// crossings stepped incrementally. Triangles are filled from their edge
+// functions in square tiles, so that tiles entirely inside or outside
+// the triangle are handled without visiting their cells. Both emit one
+// rect_t one row tall per span.
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+// How overlapping parts of a self-intersecting polygon are filled.
+enum class polygon_fill
+{
+    even_odd, // Inside when crossed by an odd number of edges.
+    nonzero,  // Inside when edges wind around it a nonzero number of times.
+};
+
+namespace impl
+{
+    // The smallest integer no less than 'n / d', for d > 0.
+    inline std::int64_t ceil_div(std::int64_t n, std::int64_t d)
+    {
+        return n >= 0 ? (n + d - 1) / d : -(-n / d);
+    }
+
+    // An edge crossing rows [y1, y2). The exact crossing of the current
+    // row is 'x - err / dy', with 0 <= err < dy, so the first cell on or
+    // right of the edge is 'x'.
+    struct polygon_edge_t
+    {
+        int2d_t y1;
+        int2d_t y2;
+        int2d_t x;
+        int2d_t err;
+        int2d_t dy;
+        int2d_t step; // floor(dx / dy)
+        int2d_t rem;  // dx - step * dy
+        int2d_t wind;
+        coord_t top;
+
+        // Sets up crossing row 'y', which can be below the top.
+        void start(int2d_t y)
+        {
+            std::int64_t const dx = std::int64_t(step) * dy + rem;
+            std::int64_t const n = dx * (y - top.y);
+            std::int64_t const c = ceil_div(n, dy);
+            x = static_cast<int2d_t>(top.x + c);
+            err = static_cast<int2d_t>(c * dy - n);
+        }
+
+        void next()
+        {
+            x += step;
+            err -= rem;
+            if(err < 0)
+            {
+                err += dy;
+                ++x;
+            }
+        }
+    };
+
+    // Calls 'func(rect_t)' with each span of the polygon in rows
+    // [y_begin, y_end), top to bottom and left to right.
+    template<typename It, typename Func>
+    void polygon_spans(It begin, It end, int2d_t y_begin, int2d_t y_end,
+                       polygon_fill fill, Func& func)
+    {
+        std::vector<polygon_edge_t> edges;
+        for(It it = begin; it != end; ++it)
+        {
+            It next = it;
+            ++next;
+            coord_t a = *it;
+            coord_t b = next == end ? *begin : *next;
+            if(a.y == b.y)
+                continue;
+            int2d_t wind = 1;
+            if(a.y > b.y)
+            {
+                std::swap(a, b);
+                wind = -1;
+            }
+            if(b.y <= y_begin || a.y >= y_end)
+                continue;
+            int2d_t const dx = b.x - a.x;
+            int2d_t const dy = b.y - a.y;
+            int2d_t step = dx / dy;
+            if(step * dy > dx)
+                --step;
+            polygon_edge_t edge = {};
+            edge.y1 = std::max(a.y, y_begin);
+            edge.y2 = std::min(b.y, y_end);
+            edge.dy = dy;
+            edge.step = step;
+            edge.rem = dx - step * dy;
+            edge.wind = wind;
+            edge.top = a;
+            edges.push_back(edge);
+        }
+        if(edges.empty())
+            return;
+
+        std::sort(edges.begin(), edges.end(),
+                  [](polygon_edge_t const& a, polygon_edge_t const& b)
+                  {
+                      return a.y1 < b.y1;
+                  });
+
+        std::vector<polygon_edge_t> active;
+        std::size_t next_edge = 0;
+        int2d_t y = edges.front().y1;
+        while(next_edge < edges.size() || !active.empty())
+        {
+            if(active.empty())
+                y = edges[next_edge].y1;
+            for(; next_edge < edges.size() && edges[next_edge].y1 == y;
+                ++next_edge)
+            {
+                polygon_edge_t edge = edges[next_edge];
+                edge.start(y);
+                active.push_back(edge);
+            }
+
+            // Crossings move little from row to row, so the active edges
+            // stay nearly sorted.
+            for(std::size_t i = 1; i < active.size(); ++i)
+            {
+                polygon_edge_t const edge = active[i];
+                std::size_t j = i;
+                for(; j > 0 && edge.x < active[j - 1].x; --j)
+                    active[j] = active[j - 1];
+                active[j] = edge;
+            }
+
+            int2d_t wind = 0;
+            for(std::size_t i = 0; i + 1 < active.size(); ++i)
+            {
+                if(fill == polygon_fill::even_odd)
+                    wind ^= 1;
+                else
+                    wind += active[i].wind;
+                int2d_t const x1 = active[i].x;
+                int2d_t const x2 = active[i + 1].x;
+                if(wind != 0 && x2 > x1)
+                    func(rect_t{ { x1, y }, { x2 - x1, 1 } });
+            }
+
+            ++y;
+            std::size_t kept = 0;
+            for(polygon_edge_t& edge : active)
+            {
+                if(edge.y2 == y)
+                    continue;
+                edge.next();
+                active[kept++] = edge;
+            }
+            active.resize(kept);
+        }
+    }
+
+    // The edge function of a -> b, which is positive right of the edge
+    // when y points down. It's biased by one off the top-left edges so
+    // that 'eval(p) >= 0' applies the fill rule.
+    struct triangle_edge_t
+    {
+        std::int64_t a;
+        std::int64_t b;
+        std::int64_t c;
+
+        triangle_edge_t(coord_t from, coord_t to)
+        {
+            std::int64_t const dx = to.x - from.x;
+            std::int64_t const dy = to.y - from.y;
+            bool const top_left = dy < 0 || (dy == 0 && dx > 0);
+            a = -dy;
+            b = dx;
+            c = dy * from.x - dx * from.y - (top_left ? 0 : 1);
+        }
+
+        std::int64_t eval(coord_t p) const { return a * p.x + b * p.y + c; }
+    };
+
+    // Calls 'func(rect_t)' with the span of each row of the triangle
+    // within 'clip', top to bottom.
+    template<typename Func>
+    void triangle_spans(coord_t p0, coord_t p1, coord_t p2, rect_t clip,
+                        Func& func)
+    {
+        constexpr int2d_t tile = 8;
+
+        std::int64_t const area2 =
+            std::int64_t(p1.x - p0.x) * (p2.y - p0.y)
+            - std::int64_t(p1.y - p0.y) * (p2.x - p0.x);
+        if(area2 == 0)
+            return;
+        if(area2 < 0)
+            std::swap(p1, p2);
+        triangle_edge_t const edges[3] =
+            { { p0, p1 }, { p1, p2 }, { p2, p0 } };
+
+        // Cells on the bottom or right of the bounds are never inside.
+        int2d_t const x1 = std::max(clip.c.x, std::min({ p0.x, p1.x, p2.x }));
+        int2d_t const y1 = std::max(clip.c.y, std::min({ p0.y, p1.y, p2.y }));
+        int2d_t const x2 = std::min(clip.ex(), std::max({ p0.x, p1.x, p2.x }));
+        int2d_t const y2 = std::min(clip.ey(), std::max({ p0.y, p1.y, p2.y }));
+
+        // Each row of a triangle is one span, so the pieces found in each
+        // tile of a row of tiles join up into [first, last].
+        int2d_t first[tile];
+        int2d_t last[tile];
+        for(int2d_t ty = y1; ty < y2; ty += tile)
+        {
+            int2d_t const th = std::min(tile, y2 - ty);
+            std::fill_n(first, th, x2);
+            std::fill_n(last, th, x1 - 1);
+
+            // Visits the tile at 'tx', returning whether it's entirely
+            // inside the triangle.
+            auto visit = [&](int2d_t tx)
+            {
+                int2d_t const tw = std::min(tile, x2 - tx);
+
+                // Edge functions are linear, so their extremes over the
+                // tile are at its corners.
+                bool outside = false;
+                bool inside = true;
+                std::int64_t w[3];
+                for(int i = 0; i < 3; ++i)
+                {
+                    triangle_edge_t const& e = edges[i];
+                    w[i] = e.eval({ tx, ty });
+                    std::int64_t const ex = e.a * (tw - 1);
+                    std::int64_t const ey = e.b * (th - 1);
+                    std::int64_t const lo =
+                        w[i] + std::min<std::int64_t>(ex, 0)
+                             + std::min<std::int64_t>(ey, 0);
+                    std::int64_t const hi =
+                        w[i] + std::max<std::int64_t>(ex, 0)
+                             + std::max<std::int64_t>(ey, 0);
+                    outside |= hi < 0;
+                    inside &= lo >= 0;
+                }
+                if(outside)
+                    return false;
+                if(inside)
+                {
+                    for(int2d_t y = 0; y < th; ++y)
+                    {
+                        first[y] = std::min(first[y], tx);
+                        last[y] = std::max(last[y], tx + tw - 1);
+                    }
+                    return true;
+                }
+
+                for(int2d_t y = 0; y < th; ++y)
+                {
+                    // Covered cells are contiguous, so only the number
+                    // of them and the first one are needed.
+                    int2d_t count = 0;
+                    int2d_t start = tw;
+                    for(int2d_t x = tw - 1; x >= 0; --x)
+                    {
+                        std::int64_t const v =
+                            (w[0] + edges[0].a * x)
+                            | (w[1] + edges[1].a * x)
+                            | (w[2] + edges[2].a * x);
+                        count += v >= 0;
+                        start = v >= 0 ? x : start;
+                    }
+                    if(count > 0)
+                    {
+                        first[y] = std::min(first[y], tx + start);
+                        last[y] = std::max(last[y], tx + start + count - 1);
+                    }
+                    for(int i = 0; i < 3; ++i)
+                        w[i] += edges[i].b;
+                }
+                return false;
+            };
+
+            // The tiles entirely inside a convex shape are contiguous, so
+            // after finding the first and last of them from either end,
+            // the tiles between can be skipped.
+            int2d_t const tiles = (x2 - x1 + tile - 1) / tile;
+            int2d_t i = 0;
+            while(i < tiles && !visit(x1 + i * tile))
+                ++i;
+            for(int2d_t j = tiles - 1; j > i; --j)
+                if(visit(x1 + j * tile))
+                    break;
+
+            for(int2d_t y = 0; y < th; ++y)
+                if(last[y] >= first[y])
+                    func(rect_t{ { first[y], ty + y },
+                                 { last[y] - first[y] + 1, 1 } });
+        }
+    }
+
+    // Calls 'func(T* row, int2d_t length, coord_t start)' with 'span'
+    // cropped to 'grid'.
+    template<typename Grid, typename Func>
+    void grid_span(Grid& grid, rect_t span, Func& func)
+    {
+        span = crop(span, grid.dimen());
+        if(span.d.w > 0 && span.d.h > 0)
+            func(grid.data() + grid_index(grid.dimen(), span.c), span.d.w,
+                 span.c);
+    }
+} // namespace impl
+
+// Calls 'func(rect_t)' with each span of the polygon with vertices
+// [begin, end), top to bottom and left to right. The last vertex joins
+// back to the first.
+template<typename It, typename Func>
+void polygon_spans(It begin, It end, Func func,
+                   polygon_fill fill = polygon_fill::even_odd)
+{
+    impl::polygon_spans(begin, end,
+                        std::numeric_limits<int2d_t>::min(),
+                        std::numeric_limits<int2d_t>::max(), fill, func);
+}
+
+// Calls 'func(rect_t)' with the span of each row of the triangle, top to
+// bottom. Only rows and cells within 'clip' are visited.
+template<typename Func>
+void triangle_spans(coord_t a, coord_t b, coord_t c, rect_t clip, Func func)
+{
+    impl::triangle_spans(a, b, c, clip, func);
+}
+
+template<typename Func>
+void triangle_spans(coord_t a, coord_t b, coord_t c, Func func)
+{
+    coord_t const crds[3] = { a, b, c };
+    impl::triangle_spans(a, b, c, rect_from_n_coords(crds, crds + 3), func);
+}
+
+// Grid-aware versions. These crop to 'grid' and call
+// 'func(T* row, int2d_t length, coord_t start)', where 'row' points to
+// the cell at 'start'. Pass a const grid for const pointers.
+
+template<typename Grid, typename It, typename Func>
+void for_each_polygon_row(Grid& grid, It begin, It end, Func func,
+                          polygon_fill fill = polygon_fill::even_odd)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    auto span_func = [&grid, &func](rect_t span)
+    {
+        impl::grid_span(grid, span, func);
+    };
+    impl::polygon_spans(begin, end, 0, grid.dimen().h, fill, span_func);
+}
+
+template<typename Grid, typename Func>
+void for_each_triangle_row(Grid& grid, coord_t a, coord_t b, coord_t c,
+                           Func func)
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    auto span_func = [&grid, &func](rect_t span)
+    {
+        impl::grid_span(grid, span, func);
+    };
+    impl::triangle_spans(a, b, c, to_rect(grid.dimen()), span_func);
+}
+
+template<typename Grid, typename It>
+void fill_polygon(Grid& grid, It begin, It end,
+                  typename Grid::value_type const& value,
+                  polygon_fill fill = polygon_fill::even_odd)
+{
+    using value_type = typename Grid::value_type;
+    for_each_polygon_row(grid, begin, end,
+                         [&value](value_type* row, int2d_t length, coord_t)
+                         {
+                             std::fill_n(row, length, value);
+                         },
+                         fill);
+}
+
+template<typename Grid>
+void fill_triangle(Grid& grid, coord_t a, coord_t b, coord_t c,
+                   typename Grid::value_type const& value)
+{
+    using value_type = typename Grid::value_type;
+    for_each_triangle_row(grid, a, b, c,
+                          [&value](value_type* row, int2d_t length, coord_t)
+                          {
+                              std::fill_n(row, length, value);
+                          });
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,302 @@
+#ifndef INT2D_QUADTREE_HPP
+#define INT2D_QUADTREE_HPP
+
+// A region quadtree: a grid stored as a tree of square blocks that each
+// hold a single value. Blocks are merged whenever their four quadrants
+// agree, so memory and whole-region queries scale with the amount of
+// boundary between values rather than with area.
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+// 'T' must be default constructible and equality comparable.
+template<typename T>
+class region_quadtree_t
+{
+public:
+    using value_type = T;
+
+    region_quadtree_t() = default;
+
+    template<typename Grid>
+    explicit region_quadtree_t(Grid const& grid)
+    : m_dim(grid.dimen())
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        if(!m_dim)
+            return;
+        while(m_size < m_dim.w || m_size < m_dim.h)
+            m_size *= 2;
+        m_nodes.push_back({ T(), leaf });
+        build(grid, 0, root_rect());
+    }
+
+    dimen_t dimen() const { return m_dim; }
+
+    T const& operator[](coord_t crd) const
+    {
+        assert(in_bounds(crd, m_dim));
+        std::int32_t i = 0;
+        rect_t r = root_rect();
+        while(m_nodes[i].child != leaf)
+        {
+            int const q = quadrant_of(r, crd);
+            i = m_nodes[i].child + q;
+            r = quadrant(r, q);
+        }
+        return m_nodes[i].value;
+    }
+
+    // Sets a single cell, splitting and merging blocks as needed.
+    void set(coord_t crd, T const& value)
+    {
+        assert(in_bounds(crd, m_dim));
+        std::int32_t path[32];
+        rect_t rects[32];
+        int depth = 0;
+        std::int32_t i = 0;
+        rect_t r = root_rect();
+        while(true)
+        {
+            path[depth] = i;
+            rects[depth] = r;
+            ++depth;
+            if(m_nodes[i].child == leaf)
+            {
+                if(m_nodes[i].value == value)
+                    return;
+                if(r.d.w == 1)
+                    break;
+                split(i);
+            }
+            int const q = quadrant_of(r, crd);
+            i = m_nodes[i].child + q;
+            r = quadrant(r, q);
+        }
+        m_nodes[i].value = value;
+
+        for(int d = depth - 2; d >= 0; --d)
+            if(!try_merge(path[d], rects[d]))
+                break;
+    }
+
+    // Returns true if every cell of 'r' (cropped to the grid) holds the
+    // same value, storing that value in '*value' if it's not null.
+    // Empty rects count as uniform.
+    // Blocks are always merged, so any split block inside 'r' answers
+    // false at once. Only the blocks along the border of 'r' are visited,
+    // which is O(log n + perimeter of 'r') rather than O(area).
+    bool uniform(rect_t r, T* value = nullptr) const
+    {
+        r = crop(r, m_dim);
+        if(!r)
+            return true;
+        T const* found = nullptr;
+        if(!uniform_impl(0, root_rect(), r, found))
+            return false;
+        if(value)
+            *value = *found;
+        return true;
+    }
+
+    // Calls 'func(rect_t, T const&)' for each block, cropped to the grid.
+    template<typename Func>
+    void for_each_leaf(Func func) const
+    {
+        for_each_leaf(to_rect(m_dim), func);
+    }
+
+    // Calls 'func(rect_t, T const&)' for each block overlapping 'r',
+    // cropped to 'r'.
+    template<typename Func>
+    void for_each_leaf(rect_t r, Func func) const
+    {
+        r = crop(r, m_dim);
+        if(r)
+            for_each_leaf_impl(0, root_rect(), r, func);
+    }
+
+    template<typename Grid>
+    void to_grid(Grid& grid) const
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(grid.dimen() == m_dim);
+        for_each_leaf([&grid](rect_t r, T const& value)
+        {
+            for(int2d_t y = r.c.y; y < r.ey(); ++y)
+            for(int2d_t x = r.c.x; x < r.ex(); ++x)
+                grid[coord_t{ x, y }] = value;
+        });
+    }
+
+    grid_t<T> to_grid() const
+    {
+        grid_t<T> grid(m_dim);
+        to_grid(grid);
+        return grid;
+    }
+
+    std::size_t node_count() const
+    {
+        return m_nodes.size() - 4 * m_free.size();
+    }
+private:
+    static constexpr std::int32_t leaf = -1;
+
+    struct node_t
+    {
+        T value;
+        std::int32_t child; // Index of the first of 4 children, or 'leaf'.
+    };
+
+    rect_t root_rect() const { return { { 0, 0 }, square_dimen(m_size) }; }
+
+    // Quadrants are numbered NW, NE, SW, SE.
+    static rect_t quadrant(rect_t r, int q)
+    {
+        int2d_t const half = r.d.w / 2;
+        return { { r.c.x + (q & 1) * half, r.c.y + (q >> 1) * half },
+                 square_dimen(half) };
+    }
+
+    static int quadrant_of(rect_t r, coord_t crd)
+    {
+        int2d_t const half = r.d.w / 2;
+        return (crd.x >= r.c.x + half) | ((crd.y >= r.c.y + half) << 1);
+    }
+
+    // Parts of the tree outside the grid are ignored when merging.
+    bool present(rect_t r) const
+    {
+        return overlapping(r, to_rect(m_dim));
+    }
+
+    std::int32_t alloc_children()
+    {
+        if(!m_free.empty())
+        {
+            std::int32_t const first = m_free.back();
+            m_free.pop_back();
+            return first;
+        }
+        std::int32_t const first = m_nodes.size();
+        m_nodes.resize(m_nodes.size() + 4);
+        return first;
+    }
+
+    void split(std::int32_t i)
+    {
+        std::int32_t const first = alloc_children();
+        for(int q = 0; q < 4; ++q)
+            m_nodes[first + q] = { m_nodes[i].value, leaf };
+        m_nodes[i].child = first;
+    }
+
+    // Turns node 'i' into a leaf if its present children are leaves
+    // holding the same value.
+    bool try_merge(std::int32_t i, rect_t r)
+    {
+        std::int32_t const first = m_nodes[i].child;
+        T const* value = nullptr;
+        for(int q = 0; q < 4; ++q)
+        {
+            if(!present(quadrant(r, q)))
+                continue;
+            node_t const& c = m_nodes[first + q];
+            if(c.child != leaf || (value && !(c.value == *value)))
+                return false;
+            value = &c.value;
+        }
+        m_nodes[i].value = *value;
+        m_nodes[i].child = leaf;
+        m_free.push_back(first);
+        return true;
+    }
+
+    template<typename Grid>
+    void build(Grid const& grid, std::int32_t i, rect_t r)
+    {
+        if(r.d.w == 1)
+        {
+            m_nodes[i].value = grid[r.c];
+            return;
+        }
+
+        // Children are appended depth-first, so if they all end up as
+        // leaves they're the last four nodes and can simply be popped.
+        std::int32_t const first = m_nodes.size();
+        m_nodes.resize(m_nodes.size() + 4, { T(), leaf });
+        m_nodes[i].child = first;
+        for(int q = 0; q < 4; ++q)
+        {
+            rect_t const qr = quadrant(r, q);
+            if(present(qr))
+                build(grid, first + q, qr);
+        }
+        if(try_merge(i, r))
+        {
+            m_free.pop_back();
+            m_nodes.resize(first);
+        }
+    }
+
+    bool uniform_impl(std::int32_t i, rect_t nr, rect_t r,
+                      T const*& found) const
+    {
+        node_t const& node = m_nodes[i];
+        if(node.child == leaf)
+        {
+            if(found && !(node.value == *found))
+                return false;
+            found = &node.value;
+            return true;
+        }
+        // A split block holds at least two values within the grid.
+        if(in_bounds(crop(nr, m_dim), r))
+            return false;
+        for(int q = 0; q < 4; ++q)
+        {
+            rect_t const qr = quadrant(nr, q);
+            if(overlapping(qr, r)
+               && !uniform_impl(node.child + q, qr, r, found))
+                return false;
+        }
+        return true;
+    }
+
+    template<typename Func>
+    void for_each_leaf_impl(std::int32_t i, rect_t nr, rect_t r,
+                            Func& func) const
+    {
+        node_t const& node = m_nodes[i];
+        if(node.child == leaf)
+        {
+            func(crop(nr, r), node.value);
+            return;
+        }
+        for(int q = 0; q < 4; ++q)
+        {
+            rect_t const qr = quadrant(nr, q);
+            if(overlapping(qr, r))
+                for_each_leaf_impl(node.child + q, qr, r, func);
+        }
+    }
+
+    dimen_t m_dim = { 0, 0 };
+    int2d_t m_size = 1;
+    std::vector<node_t> m_nodes;
+    std::vector<std::int32_t> m_free; // Unused blocks of 4 nodes.
+};
+
+template<typename T>
+constexpr std::int32_t region_quadtree_t<T>::leaf;
+
+} // namespace i2d
+
+#endif
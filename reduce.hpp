@@ -0,0 +1,362 @@
+#ifndef INT2D_REDUCE_HPP
+#define INT2D_REDUCE_HPP
+
+// Reductions over grids and sub-rects of grids.
+//
+// Rows are scanned through raw pointers in plain loops that the compiler
+// can vectorize, and are split into bands across threads with
+// 'parallel_bands'. When a rect spans whole rows, each band is scanned
+// as one long row. 'find_first' and 'any_of' stop as soon as an answer
+// is known.
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+namespace impl
+{
+    // Calls 'func(T const* row, std::ptrdiff_t length, int2d_t y)' on each
+    // band of rows in 'r', merging rows together where 'r' spans the grid.
+    // Merged rows can hold more than 2^31 cells, hence the wider length.
+    template<typename Grid, typename Func>
+    void for_each_row_band(Grid const& grid, rect_t r, int2d_t b, int2d_t e,
+                           Func& func)
+    {
+        std::ptrdiff_t const stride = grid.dimen().w;
+        auto const* const data = grid.data();
+        if(r.d.w == stride)
+            func(data + b * stride, (e - b) * stride, b);
+        else
+            for(int2d_t y = b; y < e; ++y)
+                func(data + y * stride + r.c.x, std::ptrdiff_t(r.d.w), y);
+    }
+
+    // Reduces each band into its own 'Acc' starting from 'init' with
+    // 'row_func(Acc&, T const* row, std::ptrdiff_t length)', then combines the
+    // bands with 'merge(Acc& into, Acc const& from)'.
+    template<typename Acc, typename Grid, typename RowFunc, typename Merge>
+    Acc reduce_rows(Grid const& grid, rect_t r, Acc const& init,
+                    RowFunc row_func, Merge merge, parallel_opts_t opts)
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(in_bounds(r, grid.dimen()));
+        Acc ret = init;
+        if(r.d.w <= 0 || r.d.h <= 0)
+            return ret;
+        std::mutex mutex;
+        parallel_bands(r.c.y, r.ey(), [&](int2d_t b, int2d_t e)
+        {
+            Acc acc = init;
+            auto band_func = [&](auto const* row, std::ptrdiff_t length,
+                                 int2d_t)
+            {
+                row_func(acc, row, length);
+            };
+            for_each_row_band(grid, r, b, e, band_func);
+            std::lock_guard<std::mutex> lock(mutex);
+            merge(ret, acc);
+        }, opts);
+        return ret;
+    }
+
+    // The index of the first cell in 'row' matching 'pred', or 'length'.
+    // Blocks are tested with a branch-free OR so that the common case of
+    // no match vectorizes, then the block that matched is searched.
+    template<typename T, typename Pred>
+    std::ptrdiff_t find_in_row(T const* row, std::ptrdiff_t length,
+                               Pred& pred)
+    {
+        constexpr std::ptrdiff_t block = 32;
+        std::ptrdiff_t x = 0;
+        for(; x + block <= length; x += block)
+        {
+            bool hit = false;
+            for(std::ptrdiff_t i = 0; i < block; ++i)
+                hit |= static_cast<bool>(pred(row[x + i]));
+            if(hit)
+                break;
+        }
+        for(; x < length; ++x)
+            if(pred(row[x]))
+                return x;
+        return length;
+    }
+} // namespace impl
+
+// The number of cells in 'r' for which 'pred(value)' is true.
+template<typename Grid, typename Pred>
+std::size_t count_if(Grid const& grid, rect_t r, Pred pred,
+                     parallel_opts_t opts = {})
+{
+    return impl::reduce_rows(
+        grid, r, std::size_t(0),
+        [&pred](std::size_t& acc, auto const* row, std::ptrdiff_t length)
+        {
+            std::size_t n = 0;
+            for(std::ptrdiff_t i = 0; i < length; ++i)
+                n += pred(row[i]) ? 1 : 0;
+            acc += n;
+        },
+        [](std::size_t& into, std::size_t from) { into += from; },
+        opts);
+}
+
+template<typename Grid, typename Pred>
+std::size_t count_if(Grid const& grid, Pred pred, parallel_opts_t opts = {})
+{
+    return count_if(grid, to_rect(grid.dimen()), pred, opts);
+}
+
+// The number of cells in 'r' equal to 'value'.
+template<typename Grid>
+std::size_t count(Grid const& grid, rect_t r,
+                  typename Grid::value_type const& value,
+                  parallel_opts_t opts = {})
+{
+    using value_type = typename Grid::value_type;
+    return count_if(grid, r,
+                    [&value](value_type const& v) { return v == value; },
+                    opts);
+}
+
+template<typename Grid>
+std::size_t count(Grid const& grid, typename Grid::value_type const& value,
+                  parallel_opts_t opts = {})
+{
+    return count(grid, to_rect(grid.dimen()), value, opts);
+}
+
+// The smallest and largest values in 'r', which must not be empty.
+template<typename Grid>
+std::pair<typename Grid::value_type, typename Grid::value_type>
+min_max(Grid const& grid, rect_t r, parallel_opts_t opts = {})
+{
+    using value_type = typename Grid::value_type;
+    using acc_t = std::pair<value_type, value_type>;
+    assert(r.d.w > 0 && r.d.h > 0);
+    value_type const& first = grid[r.c];
+    return impl::reduce_rows(
+        grid, r, acc_t(first, first),
+        [](acc_t& acc, value_type const* row, std::ptrdiff_t length)
+        {
+            // Separate lanes let floating point types vectorize, as the
+            // compiler can't reorder a single chain of comparisons.
+            constexpr std::ptrdiff_t lanes = 8;
+            value_type lo[lanes];
+            value_type hi[lanes];
+            for(std::ptrdiff_t j = 0; j < lanes; ++j)
+            {
+                lo[j] = acc.first;
+                hi[j] = acc.second;
+            }
+            std::ptrdiff_t i = 0;
+            for(; i + lanes <= length; i += lanes)
+            for(std::ptrdiff_t j = 0; j < lanes; ++j)
+            {
+                lo[j] = row[i + j] < lo[j] ? row[i + j] : lo[j];
+                hi[j] = hi[j] < row[i + j] ? row[i + j] : hi[j];
+            }
+            for(; i < length; ++i)
+            {
+                lo[0] = row[i] < lo[0] ? row[i] : lo[0];
+                hi[0] = hi[0] < row[i] ? row[i] : hi[0];
+            }
+            for(std::ptrdiff_t j = 1; j < lanes; ++j)
+            {
+                lo[0] = lo[j] < lo[0] ? lo[j] : lo[0];
+                hi[0] = hi[0] < hi[j] ? hi[j] : hi[0];
+            }
+            acc = { lo[0], hi[0] };
+        },
+        [](acc_t& into, acc_t const& from)
+        {
+            if(from.first < into.first)
+                into.first = from.first;
+            if(into.second < from.second)
+                into.second = from.second;
+        },
+        opts);
+}
+
+template<typename Grid>
+std::pair<typename Grid::value_type, typename Grid::value_type>
+min_max(Grid const& grid, parallel_opts_t opts = {})
+{
+    return min_max(grid, to_rect(grid.dimen()), opts);
+}
+
+// Counts the cells of 'r' by 'key(value)', which should return an index
+// into the result. Indexes of 'bins' or more are not counted.
+template<typename Grid, typename Key>
+std::vector<std::size_t> histogram(Grid const& grid, rect_t r,
+                                   std::size_t bins, Key key,
+                                   parallel_opts_t opts = {})
+{
+    using acc_t = std::vector<std::size_t>;
+    return impl::reduce_rows(
+        grid, r, acc_t(bins, 0),
+        [&key, bins](acc_t& acc, auto const* row, std::ptrdiff_t length)
+        {
+            for(std::ptrdiff_t i = 0; i < length; ++i)
+            {
+                std::size_t const bin = key(row[i]);
+                if(bin < bins)
+                    ++acc[bin];
+            }
+        },
+        [bins](acc_t& into, acc_t const& from)
+        {
+            for(std::size_t i = 0; i < bins; ++i)
+                into[i] += from[i];
+        },
+        opts);
+}
+
+// Counts the cells of 'r' by value. Values must convert to an index.
+template<typename Grid>
+std::vector<std::size_t> histogram(Grid const& grid, rect_t r,
+                                   std::size_t bins,
+                                   parallel_opts_t opts = {})
+{
+    using value_type = typename Grid::value_type;
+    return histogram(grid, r, bins,
+                     [](value_type const& v)
+                     {
+                         return static_cast<std::size_t>(v);
+                     },
+                     opts);
+}
+
+template<typename Grid>
+std::vector<std::size_t> histogram(Grid const& grid, std::size_t bins,
+                                   parallel_opts_t opts = {})
+{
+    return histogram(grid, to_rect(grid.dimen()), bins, opts);
+}
+
+// Finds the first cell of 'r' in row-major order for which 'pred(value)'
+// is true, storing its coordinate in 'found'. Returns false if there
+// isn't one. Bands stop scanning once an earlier row has a match.
+template<typename Grid, typename Pred>
+bool find_first(Grid const& grid, rect_t r, Pred pred, coord_t& found,
+                parallel_opts_t opts = {})
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    assert(in_bounds(r, grid.dimen()));
+    if(r.d.w <= 0 || r.d.h <= 0)
+        return false;
+
+    // Positions are row-major offsets from 'r.c'.
+    long long const none = static_cast<long long>(r.d.w) * r.d.h;
+    std::atomic<long long> best(none);
+    parallel_bands(r.c.y, r.ey(), [&](int2d_t b, int2d_t e)
+    {
+        bool done = false;
+        auto row_func = [&](auto const* row, std::ptrdiff_t length,
+                            int2d_t y)
+        {
+            long long const start = static_cast<long long>(y - r.c.y) * r.d.w;
+            if(done || start >= best.load(std::memory_order_relaxed))
+            {
+                done = true;
+                return;
+            }
+            std::ptrdiff_t const x = impl::find_in_row(row, length, pred);
+            if(x == length)
+                return;
+            done = true;
+            long long const pos = start + x;
+            long long cur = best.load(std::memory_order_relaxed);
+            while(pos < cur && !best.compare_exchange_weak(cur, pos))
+                ;
+        };
+        impl::for_each_row_band(grid, r, b, e, row_func);
+    }, opts);
+
+    long long const pos = best.load();
+    if(pos == none)
+        return false;
+    found = { static_cast<int2d_t>(r.c.x + pos % r.d.w),
+              static_cast<int2d_t>(r.c.y + pos / r.d.w) };
+    return true;
+}
+
+template<typename Grid, typename Pred>
+bool find_first(Grid const& grid, Pred pred, coord_t& found,
+                parallel_opts_t opts = {})
+{
+    return find_first(grid, to_rect(grid.dimen()), pred, found, opts);
+}
+
+// Whether 'pred(value)' is true for any cell of 'r'.
+// Every band stops scanning as soon as any band finds a match.
+template<typename Grid, typename Pred>
+bool any_of(Grid const& grid, rect_t r, Pred pred, parallel_opts_t opts = {})
+{
+    static_assert(is_grid<Grid>::value, "must be a Grid");
+    assert(in_bounds(r, grid.dimen()));
+    if(r.d.w <= 0 || r.d.h <= 0)
+        return false;
+
+    std::atomic<bool> hit(false);
+    parallel_bands(r.c.y, r.ey(), [&](int2d_t b, int2d_t e)
+    {
+        auto row_func = [&](auto const* row, std::ptrdiff_t length, int2d_t)
+        {
+            if(hit.load(std::memory_order_relaxed))
+                return;
+            if(impl::find_in_row(row, length, pred) != length)
+                hit.store(true, std::memory_order_relaxed);
+        };
+        impl::for_each_row_band(grid, r, b, e, row_func);
+    }, opts);
+    return hit.load();
+}
+
+template<typename Grid, typename Pred>
+bool any_of(Grid const& grid, Pred pred, parallel_opts_t opts = {})
+{
+    return any_of(grid, to_rect(grid.dimen()), pred, opts);
+}
+
+// Whether 'pred(value)' is true for every cell of 'r'.
+template<typename Grid, typename Pred>
+bool all_of(Grid const& grid, rect_t r, Pred pred, parallel_opts_t opts = {})
+{
+    using value_type = typename Grid::value_type;
+    return !any_of(grid, r,
+                   [&pred](value_type const& v) { return !pred(v); },
+                   opts);
+}
+
+template<typename Grid, typename Pred>
+bool all_of(Grid const& grid, Pred pred, parallel_opts_t opts = {})
+{
+    return all_of(grid, to_rect(grid.dimen()), pred, opts);
+}
+
+// Whether 'pred(value)' is false for every cell of 'r'.
+template<typename Grid, typename Pred>
+bool none_of(Grid const& grid, rect_t r, Pred pred, parallel_opts_t opts = {})
+{
+    return !any_of(grid, r, pred, opts);
+}
+
+template<typename Grid, typename Pred>
+bool none_of(Grid const& grid, Pred pred, parallel_opts_t opts = {})
+{
+    return !any_of(grid, pred, opts);
+}
+
+} // namespace i2d
+
+#endif
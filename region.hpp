@@ -0,0 +1,308 @@
+#ifndef INT2D_REGION_HPP
+#define INT2D_REGION_HPP
+
+// Sets of cells stored as disjoint rects, in the style of X11 regions.
+//
+// Rects are grouped into horizontal bands: every rect in a band has the
+// same top and height, rects within a band are sorted by x and never
+// touch, and bands are sorted by y. Vertically adjacent bands with the
+// same spans are always merged, which makes the representation unique.
+//
+// Boolean operations walk both regions' bands once, so they run in time
+// linear in the number of rects.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace i2d {
+
+class region_t
+{
+public:
+    using const_iterator = std::vector<rect_t>::const_iterator;
+
+    region_t() = default;
+
+    region_t(rect_t r)
+    {
+        if(r.d.w > 0 && r.d.h > 0)
+            m_rects.push_back(r);
+    }
+
+    // The union of every rect in [begin, end).
+    template<typename It>
+    region_t(It begin, It end)
+    {
+        std::vector<region_t> parts(begin, end);
+        if(parts.empty())
+            return;
+        // Merging pairwise keeps the total work at O(n log n).
+        for(std::size_t step = 1; step < parts.size(); step *= 2)
+            for(std::size_t i = 0; i + step < parts.size(); i += step * 2)
+                parts[i] |= parts[i + step];
+        *this = std::move(parts.front());
+    }
+
+    const_iterator begin() const { return m_rects.begin(); }
+    const_iterator end() const { return m_rects.end(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    std::vector<rect_t> const& rects() const { return m_rects; }
+    std::size_t size() const { return m_rects.size(); }
+    bool empty() const { return m_rects.empty(); }
+
+    void clear() { m_rects.clear(); }
+
+    // The smallest rect containing the region.
+    rect_t extents() const
+    {
+        if(m_rects.empty())
+            return { { 0, 0 }, { 0, 0 } };
+        int2d_t x1 = m_rects.front().c.x;
+        int2d_t x2 = m_rects.front().ex();
+        for(rect_t const& r : m_rects)
+        {
+            x1 = std::min(x1, r.c.x);
+            x2 = std::max(x2, r.ex());
+        }
+        int2d_t const y1 = m_rects.front().c.y;
+        int2d_t const y2 = m_rects.back().ey();
+        return { { x1, y1 }, { x2 - x1, y2 - y1 } };
+    }
+
+    // The number of cells in the region.
+    std::size_t area() const
+    {
+        std::size_t sum = 0;
+        for(rect_t const& r : m_rects)
+            sum += static_cast<std::size_t>(i2d::area(r));
+        return sum;
+    }
+
+    // O(log n).
+    bool contains(coord_t crd) const
+    {
+        // Find the first rect below 'crd', then the first rect in
+        // its band that ends right of 'crd'.
+        auto band = std::upper_bound(
+            m_rects.begin(), m_rects.end(), crd.y,
+            [](int2d_t y, rect_t const& r) { return y < r.ey(); });
+        if(band == m_rects.end() || band->c.y > crd.y)
+            return false;
+        int2d_t const band_y = band->c.y;
+        auto band_end = std::upper_bound(
+            band, m_rects.end(), band_y,
+            [](int2d_t y, rect_t const& r) { return y < r.c.y; });
+        auto it = std::upper_bound(
+            band, band_end, crd.x,
+            [](int2d_t x, rect_t const& r) { return x < r.ex(); });
+        return it != band_end && it->c.x <= crd.x;
+    }
+
+    void translate(coord_t offset)
+    {
+        for(rect_t& r : m_rects)
+            r += offset;
+    }
+
+    region_t& operator|=(region_t const& rhs)
+    {
+        return *this = combine(*this, rhs,
+                               [](bool a, bool b) { return a || b; });
+    }
+
+    region_t& operator&=(region_t const& rhs)
+    {
+        return *this = combine(*this, rhs,
+                               [](bool a, bool b) { return a && b; });
+    }
+
+    region_t& operator-=(region_t const& rhs)
+    {
+        return *this = combine(*this, rhs,
+                               [](bool a, bool b) { return a && !b; });
+    }
+
+    region_t& operator^=(region_t const& rhs)
+    {
+        return *this = combine(*this, rhs,
+                               [](bool a, bool b) { return a != b; });
+    }
+
+    friend bool operator==(region_t const& lhs, region_t const& rhs)
+    {
+        return lhs.m_rects == rhs.m_rects;
+    }
+
+    friend bool operator!=(region_t const& lhs, region_t const& rhs)
+    {
+        return !(lhs == rhs);
+    }
+private:
+    // Combines 'a' and 'b' using 'op(bool in_a, bool in_b)', which must
+    // return false when both arguments are false.
+    template<typename Op>
+    static region_t combine(region_t const& a, region_t const& b, Op op)
+    {
+        region_t ret;
+        std::vector<rect_t> const& ar = a.m_rects;
+        std::vector<rect_t> const& br = b.m_rects;
+        std::size_t ai = 0, bi = 0;
+        std::size_t ae = band_end(ar, 0), be = band_end(br, 0);
+        std::size_t last_band = 0; // Start of the last band in 'ret'.
+        std::vector<int2d_t> spans;
+
+        constexpr int2d_t none = std::numeric_limits<int2d_t>::max();
+        int2d_t y = std::min(ai < ar.size() ? ar[ai].c.y : none,
+                             bi < br.size() ? br[bi].c.y : none);
+        while(ai < ar.size() || bi < br.size())
+        {
+            bool const in_a = ai < ar.size() && ar[ai].c.y <= y;
+            bool const in_b = bi < br.size() && br[bi].c.y <= y;
+
+            // The next y where either region changes bands.
+            int2d_t next = none;
+            if(ai < ar.size())
+                next = std::min(next, in_a ? ar[ai].ey() : ar[ai].c.y);
+            if(bi < br.size())
+                next = std::min(next, in_b ? br[bi].ey() : br[bi].c.y);
+
+            if(in_a || in_b)
+            {
+                combine_spans(ar.data() + ai, in_a ? ae - ai : 0,
+                              br.data() + bi, in_b ? be - bi : 0,
+                              op, spans);
+                append_band(ret.m_rects, last_band, y, next, spans);
+            }
+
+            y = next;
+            if(in_a && ar[ai].ey() == y)
+            {
+                ai = ae;
+                ae = band_end(ar, ai);
+            }
+            if(in_b && br[bi].ey() == y)
+            {
+                bi = be;
+                be = band_end(br, bi);
+            }
+        }
+        return ret;
+    }
+
+    static std::size_t band_end(std::vector<rect_t> const& rects,
+                                std::size_t i)
+    {
+        std::size_t end = i;
+        while(end < rects.size() && rects[end].c.y == rects[i].c.y)
+            ++end;
+        return end;
+    }
+
+    // Writes the spans covered by 'op' as pairs of [x1, x2) to 'out'.
+    template<typename Op>
+    static void combine_spans(rect_t const* a, std::size_t an,
+                              rect_t const* b, std::size_t bn,
+                              Op op, std::vector<int2d_t>& out)
+    {
+        constexpr int2d_t none = std::numeric_limits<int2d_t>::max();
+        auto const edge = [](rect_t const* r, std::size_t i)
+        {
+            return i % 2 ? r[i / 2].ex() : r[i / 2].c.x;
+        };
+        out.clear();
+        std::size_t i = 0, j = 0;
+        bool in_a = false, in_b = false, in = false;
+        while(i < an * 2 || j < bn * 2)
+        {
+            int2d_t const xa = i < an * 2 ? edge(a, i) : none;
+            int2d_t const xb = j < bn * 2 ? edge(b, j) : none;
+            int2d_t const x = std::min(xa, xb);
+            if(xa == x)
+            {
+                in_a = !in_a;
+                ++i;
+            }
+            if(xb == x)
+            {
+                in_b = !in_b;
+                ++j;
+            }
+            if(op(in_a, in_b) != in)
+            {
+                in = !in;
+                out.push_back(x);
+            }
+        }
+        assert(!in);
+    }
+
+    // Appends a band of 'spans' covering [y1, y2), extending the last
+    // band instead if it's directly above with the same spans.
+    static void append_band(std::vector<rect_t>& rects,
+                            std::size_t& last_band, int2d_t y1, int2d_t y2,
+                            std::vector<int2d_t> const& spans)
+    {
+        if(spans.empty())
+            return;
+        std::size_t const n = spans.size() / 2;
+        if(last_band < rects.size() && rects[last_band].ey() == y1
+           && rects.size() - last_band == n)
+        {
+            bool same = true;
+            for(std::size_t i = 0; i < n && same; ++i)
+            {
+                rect_t const& r = rects[last_band + i];
+                same = r.c.x == spans[i * 2] && r.ex() == spans[i * 2 + 1];
+            }
+            if(same)
+            {
+                for(std::size_t i = last_band; i < rects.size(); ++i)
+                    rects[i].d.h += y2 - y1;
+                return;
+            }
+        }
+        last_band = rects.size();
+        for(std::size_t i = 0; i < n; ++i)
+            rects.push_back({ { spans[i * 2], y1 },
+                              { spans[i * 2 + 1] - spans[i * 2], y2 - y1 } });
+    }
+
+    std::vector<rect_t> m_rects;
+};
+
+inline region_t operator|(region_t lhs, region_t const& rhs)
+{
+    return lhs |= rhs;
+}
+
+inline region_t operator&(region_t lhs, region_t const& rhs)
+{
+    return lhs &= rhs;
+}
+
+inline region_t operator-(region_t lhs, region_t const& rhs)
+{
+    return lhs -= rhs;
+}
+
+inline region_t operator^(region_t lhs, region_t const& rhs)
+{
+    return lhs ^= rhs;
+}
+
+inline bool overlapping(region_t const& a, region_t const& b)
+{
+    return !(a & b).empty();
+}
+
+} // namespace i2d
+
+#endif
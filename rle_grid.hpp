@@ -0,0 +1,256 @@
+#ifndef INT2D_RLE_GRID_HPP
+#define INT2D_RLE_GRID_HPP
+
+// A grid stored as horizontal runs of equal values, row by row.
+// Runs are kept canonical (neighboring runs always differ), so two
+// grids hold the same values exactly when their runs are equal.
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+
+namespace i2d {
+
+template<typename T>
+class rle_grid_t
+{
+public:
+    using value_type = T;
+
+    // A run starts at 'x' and lasts until the start of the next run
+    // in the row, or the end of the row.
+    struct run_t
+    {
+        int2d_t x;
+        T value;
+    };
+
+    using row_type = std::vector<run_t>;
+
+    rle_grid_t() = default;
+
+    explicit rle_grid_t(dimen_t dim, T const& value = T())
+    : m_dim(dim)
+    , m_rows(dim.w > 0 ? dim.h : 0, row_type{ run_t{ 0, value } })
+    {}
+
+    template<typename Grid>
+    explicit rle_grid_t(Grid const& grid)
+    : m_dim(grid.dimen())
+    , m_rows(m_dim.h)
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        if(m_dim.w <= 0)
+            m_rows.clear();
+        for(int2d_t y = 0; y < static_cast<int2d_t>(m_rows.size()); ++y)
+            encode(grid, { 0, y }, m_dim.w, m_rows[y]);
+    }
+
+    dimen_t dimen() const { return m_dim; }
+
+    // O(log n) in the number of runs in the row.
+    T const& operator[](coord_t crd) const
+    {
+        assert(in_bounds(crd, m_dim));
+        return m_rows[crd.y][run_index(m_rows[crd.y], crd.x)].value;
+    }
+
+    row_type const& row(int2d_t y) const { return m_rows[y]; }
+
+    // The end of run 'i' of row 'y'.
+    int2d_t run_end(int2d_t y, std::size_t i) const
+    {
+        return run_end(m_rows[y], i);
+    }
+
+    // Calls 'func(int2d_t begin, int2d_t end, T const& value)' for each
+    // run of row 'y', where [begin, end) are the run's x coordinates.
+    template<typename Func>
+    void for_each_run(int2d_t y, Func func) const
+    {
+        row_type const& r = m_rows[y];
+        for(std::size_t i = 0; i != r.size(); ++i)
+            func(r[i].x, run_end(r, i), r[i].value);
+    }
+
+    // The total number of runs.
+    std::size_t run_count() const
+    {
+        std::size_t count = 0;
+        for(row_type const& r : m_rows)
+            count += r.size();
+        return count;
+    }
+
+    void set(coord_t crd, T const& value)
+    {
+        fill({ crd, { 1, 1 } }, value);
+    }
+
+    void fill(rect_t r, T const& value)
+    {
+        r = crop(r, m_dim);
+        row_type runs = { run_t{ r.c.x, value } };
+        for(int2d_t y = r.c.y; y < r.ey(); ++y)
+            splice(m_rows[y], r.c.x, r.ex(), runs);
+    }
+
+    // Copies 'src_rect' of this grid onto 'dest' at 'dest_crd', filling
+    // each run's span directly. 'dest' must store rows contiguously.
+    template<typename Grid>
+    void blit_to(Grid& dest, coord_t dest_crd, rect_t src_rect) const
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(in_bounds(src_rect, m_dim));
+        assert(in_bounds(rect_t{ dest_crd, src_rect.d }, dest.dimen()));
+        coord_t const offset = dest_crd - src_rect.c;
+        for(int2d_t y = src_rect.c.y; y < src_rect.ey(); ++y)
+        {
+            row_type const& r = m_rows[y];
+            for(std::size_t i = run_index(r, src_rect.c.x);
+                i != r.size() && r[i].x < src_rect.ex(); ++i)
+            {
+                int2d_t const begin = std::max(r[i].x, src_rect.c.x);
+                int2d_t const end = std::min(run_end(r, i), src_rect.ex());
+                std::fill_n(&dest[coord_t{ begin, y } + offset],
+                            end - begin, r[i].value);
+            }
+        }
+    }
+
+    // Copies 'src_rect' of 'src' onto this grid at 'dest_crd'.
+    // Only the runs overlapping the destination are rewritten.
+    template<typename Grid>
+    void blit_from(Grid const& src, rect_t src_rect, coord_t dest_crd)
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(in_bounds(src_rect, src.dimen()));
+        assert(in_bounds(rect_t{ dest_crd, src_rect.d }, m_dim));
+        if(src_rect.d.w <= 0)
+            return;
+        row_type runs;
+        for(int2d_t y = 0; y < src_rect.d.h; ++y)
+        {
+            encode(src, { src_rect.c.x, src_rect.c.y + y }, src_rect.d.w,
+                   runs);
+            for(run_t& run : runs)
+                run.x += dest_crd.x - src_rect.c.x;
+            splice(m_rows[dest_crd.y + y], dest_crd.x,
+                   dest_crd.x + src_rect.d.w, runs);
+        }
+    }
+
+    template<typename Grid>
+    void to_grid(Grid& grid) const
+    {
+        static_assert(is_grid<Grid>::value, "must be a Grid");
+        assert(grid.dimen() == m_dim);
+        blit_to(grid, { 0, 0 }, to_rect(m_dim));
+    }
+
+    grid_t<T> to_grid() const
+    {
+        grid_t<T> grid(m_dim, uninitialized);
+        to_grid(grid);
+        return grid;
+    }
+
+    friend bool operator==(rle_grid_t const& lhs, rle_grid_t const& rhs)
+    {
+        return lhs.m_dim == rhs.m_dim && lhs.m_rows == rhs.m_rows;
+    }
+
+    friend bool operator!=(rle_grid_t const& lhs, rle_grid_t const& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    friend bool operator==(run_t const& lhs, run_t const& rhs)
+    {
+        return lhs.x == rhs.x && lhs.value == rhs.value;
+    }
+private:
+    int2d_t run_end(row_type const& r, std::size_t i) const
+    {
+        return i + 1 < r.size() ? r[i + 1].x : m_dim.w;
+    }
+
+    // The index of the run containing 'x'.
+    static std::size_t run_index(row_type const& r, int2d_t x)
+    {
+        auto const it = std::upper_bound(
+            r.begin(), r.end(), x,
+            [](int2d_t x, run_t const& run) { return x < run.x; });
+        assert(it != r.begin());
+        return (it - r.begin()) - 1;
+    }
+
+    // Encodes 'length' cells of 'grid' starting at 'from' into 'out'.
+    template<typename Grid>
+    static void encode(Grid const& grid, coord_t from, int2d_t length,
+                       row_type& out)
+    {
+        out.clear();
+        for(int2d_t i = 0; i < length; ++i)
+        {
+            coord_t const crd = { from.x + i, from.y };
+            if(out.empty() || !(out.back().value == grid[crd]))
+                out.push_back({ crd.x, grid[crd] });
+        }
+    }
+
+    // Replaces cells [x0, x1) of 'r' with 'runs', which must be
+    // canonical and start at 'x0'.
+    void splice(row_type& r, int2d_t x0, int2d_t x1, row_type const& runs)
+    {
+        if(x1 <= x0)
+            return;
+        assert(!runs.empty() && runs.front().x == x0);
+        std::size_t const i = run_index(r, x0);
+        std::size_t const j = run_index(r, x1 - 1);
+
+        row_type mid;
+        if(r[i].x < x0)
+            mid.push_back(r[i]);
+        mid.insert(mid.end(), runs.begin(), runs.end());
+        if(run_end(r, j) > x1)
+            mid.push_back({ x1, r[j].value });
+
+        r.erase(r.begin() + i, r.begin() + j + 1);
+        r.insert(r.begin() + i, mid.begin(), mid.end());
+
+        // Only the seams around 'mid' can have broken canonical form.
+        std::size_t const lo = i > 0 ? i - 1 : 0;
+        std::size_t const hi = std::min(r.size(), i + mid.size() + 1);
+        std::size_t out = lo + 1;
+        for(std::size_t k = lo + 1; k < hi; ++k)
+            if(!(r[k].value == r[out - 1].value))
+                r[out++] = r[k];
+        r.erase(r.begin() + out, r.begin() + hi);
+    }
+
+    dimen_t m_dim = { 0, 0 };
+    std::vector<row_type> m_rows;
+};
+
+// Overloads of 'blit' for run-length encoded grids.
+template<typename Grid, typename T>
+void blit(Grid& dest, coord_t dest_crd, rle_grid_t<T> const& src,
+          rect_t src_rect)
+{
+    src.blit_to(dest, dest_crd, src_rect);
+}
+
+template<typename T, typename Grid>
+void blit(rle_grid_t<T>& dest, coord_t dest_crd, Grid const& src,
+          rect_t src_rect)
+{
+    dest.blit_from(src, src_rect, dest_crd);
+}
+
+} // namespace i2d
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef INT2D_SPATIAL_HASH_HPP
+#define INT2D_SPATIAL_HASH_HPP
+
+// A spatial hash for sets of moving points.
+//
+// Points are grouped into square buckets of cells, and buckets are hashed
+// into a table whose entries are stored in one flat array, sorted by
+// counting sort whenever 'rebuild' is called. Points inserted or moved to
+// a different bucket since the last rebuild are kept in a short unsorted
+// list until the next one, so every operation stays O(1) and queries are
+// always exact. The intended use is to move everything, rebuild once,
+// then query.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace i2d {
+
+template<typename T>
+class spatial_hash_t
+{
+public:
+    using value_type = T;
+    using handle_type = std::uint32_t;
+
+    // 'cell_size' is the side of each bucket and must be a power of two.
+    // Queries are fastest when it's near the typical query radius.
+    explicit spatial_hash_t(int2d_t cell_size = 16)
+    {
+        assert(cell_size > 0 && (cell_size & (cell_size - 1)) == 0);
+        while((1 << m_shift) < cell_size)
+            ++m_shift;
+        m_starts.assign(2, 0);
+    }
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_free.clear();
+        m_entries.clear();
+        m_pending.clear();
+        m_bits = 1;
+        m_starts.assign(2, 0);
+        m_size = 0;
+    }
+
+    // Adds a point, returning a handle to it. Handles of removed points
+    // are reused.
+    handle_type insert(coord_t crd, T const& value)
+    {
+        handle_type h;
+        if(m_free.empty())
+        {
+            h = static_cast<handle_type>(m_slots.size());
+            m_slots.push_back({ crd, false, none, value });
+        }
+        else
+        {
+            h = m_free.back();
+            m_free.pop_back();
+            m_slots[h] = { crd, false, none, value };
+        }
+        add_pending(h);
+        ++m_size;
+        return h;
+    }
+
+    void remove(handle_type h)
+    {
+        assert(alive(h));
+        slot_t& slot = m_slots[h];
+        if(slot.pending)
+            remove_pending(h);
+        else
+            m_entries[slot.index].handle = none;
+        slot.index = none;
+        m_free.push_back(h);
+        --m_size;
+    }
+
+    void move(handle_type h, coord_t crd)
+    {
+        assert(alive(h));
+        slot_t& slot = m_slots[h];
+        coord_t const old = slot.crd;
+        slot.crd = crd;
+        if(slot.pending)
+            m_pending[slot.index].crd = crd;
+        else if(bucket(old) == bucket(crd))
+            m_entries[slot.index].crd = crd;
+        else
+        {
+            m_entries[slot.index].handle = none;
+            add_pending(h);
+        }
+    }
+
+    coord_t position(handle_type h) const
+    {
+        assert(alive(h));
+        return m_slots[h].crd;
+    }
+
+    T& operator[](handle_type h)
+    {
+        assert(alive(h));
+        return m_slots[h].value;
+    }
+
+    T const& operator[](handle_type h) const
+    {
+        assert(alive(h));
+        return m_slots[h].value;
+    }
+
+    // Sorts every point into the flat table in O(n). The table is sized
+    // to the number of points.
+    void rebuild()
+    {
+        m_bits = 1;
+        while((std::size_t(1) << m_bits) < m_size)
+            ++m_bits;
+        std::size_t const buckets = std::size_t(1) << m_bits;
+
+        m_scratch.clear();
+        for(entry_t const& e : m_entries)
+            if(e.handle != none)
+                m_scratch.push_back(e);
+        m_scratch.insert(m_scratch.end(), m_pending.begin(), m_pending.end());
+        m_pending.clear();
+        assert(m_scratch.size() == m_size);
+
+        m_starts.assign(buckets + 1, 0);
+        for(entry_t const& e : m_scratch)
+            ++m_starts[hash(bucket(e.crd)) + 1];
+        for(std::size_t i = 1; i <= buckets; ++i)
+            m_starts[i] += m_starts[i - 1];
+
+        m_entries.resize(m_scratch.size());
+        for(entry_t const& e : m_scratch)
+        {
+            std::uint32_t const i = m_starts[hash(bucket(e.crd))]++;
+            m_entries[i] = e;
+            m_slots[e.handle].index = i;
+            m_slots[e.handle].pending = false;
+        }
+        // Counting shifted every start to the following bucket's.
+        for(std::size_t i = buckets; i > 0; --i)
+            m_starts[i] = m_starts[i - 1];
+        m_starts[0] = 0;
+    }
+
+    // Calls 'func(handle_type, coord_t)' for each point in 'r'.
+    template<typename Func>
+    void for_each_in_rect(rect_t r, Func func) const
+    {
+        for_each_candidate(r, [&](entry_t const& e)
+        {
+            if(in_bounds(e.crd, r))
+                func(e.handle, e.crd);
+        });
+    }
+
+    // Calls 'func(handle_type, coord_t)' for each point with a chess
+    // distance of at most 'radius' from 'center'.
+    template<typename Func>
+    void for_each_within_c_dist(coord_t center, int2d_t radius,
+                                Func func) const
+    {
+        for_each_in_rect(rect_from_radius(center, radius), func);
+    }
+
+    // Calls 'func(handle_type, coord_t)' for each point with a manhattan
+    // distance of at most 'radius' from 'center'.
+    template<typename Func>
+    void for_each_within_m_dist(coord_t center, int2d_t radius,
+                                Func func) const
+    {
+        for_each_candidate(rect_from_radius(center, radius),
+                           [&](entry_t const& e)
+        {
+            if(m_dist(e.crd, center) <= radius)
+                func(e.handle, e.crd);
+        });
+    }
+
+    // Calls 'func(handle_type, coord_t)' for each point with a euclidean
+    // distance of at most 'radius' from 'center'.
+    template<typename Func>
+    void for_each_within_e_dist(coord_t center, int2d_t radius,
+                                Func func) const
+    {
+        std::int64_t const limit = std::int64_t(radius) * radius;
+        for_each_candidate(rect_from_radius(center, radius),
+                           [&](entry_t const& e)
+        {
+            std::int64_t const dx = e.crd.x - center.x;
+            std::int64_t const dy = e.crd.y - center.y;
+            if(dx * dx + dy * dy <= limit)
+                func(e.handle, e.crd);
+        });
+    }
+
+private:
+    static constexpr handle_type none = ~handle_type(0);
+
+    struct slot_t
+    {
+        coord_t crd;
+        bool pending;
+        std::uint32_t index; // Into 'm_pending' or 'm_entries'.
+        T value;
+    };
+
+    struct entry_t
+    {
+        coord_t crd;
+        handle_type handle; // 'none' once removed or moved out.
+    };
+
+    bool alive(handle_type h) const
+    {
+        return h < m_slots.size() && m_slots[h].index != none;
+    }
+
+    coord_t bucket(coord_t crd) const
+    {
+        return { crd.x >> m_shift, crd.y >> m_shift };
+    }
+
+    std::uint32_t hash(coord_t b) const
+    {
+        std::uint64_t const key =
+            (std::uint64_t(std::uint32_t(b.x)) << 32) | std::uint32_t(b.y);
+        return static_cast<std::uint32_t>(
+            (key * 0x9E3779B97F4A7C15ull) >> (64 - m_bits));
+    }
+
+    void add_pending(handle_type h)
+    {
+        m_slots[h].pending = true;
+        m_slots[h].index = static_cast<std::uint32_t>(m_pending.size());
+        m_pending.push_back({ m_slots[h].crd, h });
+    }
+
+    void remove_pending(handle_type h)
+    {
+        std::uint32_t const i = m_slots[h].index;
+        m_pending[i] = m_pending.back();
+        m_slots[m_pending[i].handle].index = i;
+        m_pending.pop_back();
+    }
+
+    // Calls 'func(entry_t const&)' on every live entry that might be in
+    // 'r', and possibly some that aren't.
+    template<typename Func>
+    void for_each_candidate(rect_t r, Func func) const
+    {
+        for(entry_t const& e : m_pending)
+            func(e);
+        if(r.d.w <= 0 || r.d.h <= 0 || m_entries.empty())
+            return;
+
+        coord_t const b1 = bucket(r.c);
+        coord_t const b2 = bucket({ r.ex() - 1, r.ey() - 1 });
+        std::int64_t const count =
+            std::int64_t(b2.x - b1.x + 1) * (b2.y - b1.y + 1);
+        if(count >= std::int64_t(m_entries.size()))
+        {
+            for(entry_t const& e : m_entries)
+                if(e.handle != none)
+                    func(e);
+            return;
+        }
+
+        // Different buckets can share a hash, so entries are checked
+        // against the bucket being visited to avoid repeats.
+        for(int2d_t by = b1.y; by <= b2.y; ++by)
+        for(int2d_t bx = b1.x; bx <= b2.x; ++bx)
+        {
+            coord_t const b = { bx, by };
+            std::uint32_t const h = hash(b);
+            for(std::uint32_t i = m_starts[h]; i < m_starts[h + 1]; ++i)
+            {
+                entry_t const& e = m_entries[i];
+                if(e.handle != none && bucket(e.crd) == b)
+                    func(e);
+            }
+        }
+    }
+
+    int2d_t m_shift = 0;
+    int m_bits = 1;
+    std::size_t m_size = 0;
+    std::vector<slot_t> m_slots;
+    std::vector<handle_type> m_free;
+    std::vector<entry_t> m_entries;
+    std::vector<std::uint32_t> m_starts; // Where each hash begins.
+    std::vector<entry_t> m_pending;
+    std::vector<entry_t> m_scratch;
+};
+
+template<typename T>
+constexpr typename spatial_hash_t<T>::handle_type spatial_hash_t<T>::none;
+
+} // namespace i2d
+
+#endif
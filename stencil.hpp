@@ -0,0 +1,423 @@
+#ifndef INT2D_STENCIL_HPP
+#define INT2D_STENCIL_HPP
+
+// Neighborhood computations (convolution, cellular automata, etc)
+// over whole grids.
+//
+// Each band of rows keeps a sliding window of 2*radius+1 rows that
+// have already been extended past the grid's edges according to a
+// border policy. Inner loops then read straight from these rows with no
+// bounds checks, which lets the compiler vectorize them.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "geometry.hpp"
+#include "grid.hpp"
+#include "parallel.hpp"
+
+namespace i2d {
+
+// Border policies. These decide what cells outside the grid read as.
+struct border_clamp {}; // The nearest cell inside the grid.
+struct border_wrap {};  // The grid tiles infinitely.
+struct border_skip {};  // Cells within 'radius' of the edge aren't written.
+
+template<typename T>
+struct border_constant { T value; }; // A fixed value.
+
+template<typename T>
+constexpr border_constant<T> make_border_constant(T value)
+{
+    return { value };
+}
+
+// A square kernel of weights with the given radius.
+// The weighted sum is divided by 'divisor' before being stored.
+// Example:
+//   constexpr stencil_kernel_t<int, 1> blur =
+//       {{{ 1, 2, 1 }, { 2, 4, 2 }, { 1, 2, 1 }}, 16};
+template<typename W, int2d_t Radius>
+struct stencil_kernel_t
+{
+    static_assert(Radius >= 0, "radius must not be negative");
+
+    using weight_type = W;
+    static constexpr int2d_t radius = Radius;
+    static constexpr int2d_t size = 2 * Radius + 1;
+
+    W weights[size][size]; // [y][x]
+    W divisor = 1;
+
+    constexpr W operator()(int2d_t dx, int2d_t dy) const
+    {
+        return weights[dy + Radius][dx + Radius];
+    }
+};
+
+// A kernel in the form of an outer product of 'col' and 'row'.
+// The weighted sum is divided by 'divisor' before being stored.
+template<typename W, int2d_t Radius>
+struct separable_kernel_t
+{
+    static constexpr int2d_t radius = Radius;
+    static constexpr int2d_t size = 2 * Radius + 1;
+
+    W row[size];
+    W col[size];
+    W divisor;
+};
+
+namespace impl
+{
+    template<typename W, int2d_t R>
+    constexpr coord_t kernel_pivot(stencil_kernel_t<W, R> const& k)
+    {
+        for(int2d_t y = 0; y != k.size; ++y)
+        for(int2d_t x = 0; x != k.size; ++x)
+            if(k.weights[y][x] != W(0))
+                return { x, y };
+        return { 0, 0 };
+    }
+} // namespace impl
+
+// True if the kernel has rank 1, meaning it can be applied as
+// a horizontal pass followed by a vertical pass.
+template<typename W, int2d_t R>
+constexpr bool is_separable(stencil_kernel_t<W, R> const& k)
+{
+    coord_t const p = impl::kernel_pivot(k);
+    W const pivot = k.weights[p.y][p.x];
+    for(int2d_t y = 0; y != k.size; ++y)
+    for(int2d_t x = 0; x != k.size; ++x)
+        if(k.weights[y][x] * pivot != k.weights[y][p.x] * k.weights[p.y][x])
+            return false;
+    return true;
+}
+
+// Requires 'is_separable(k)'.
+// The result is exact for integer weights: the pivot the kernel gets
+// factored around is moved into the divisor instead of being divided out.
+template<typename W, int2d_t R>
+constexpr separable_kernel_t<W, R> separate(stencil_kernel_t<W, R> const& k)
+{
+    coord_t const p = impl::kernel_pivot(k);
+    W const pivot = k.weights[p.y][p.x];
+    separable_kernel_t<W, R> s = {};
+    for(int2d_t i = 0; i != k.size; ++i)
+    {
+        s.row[i] = k.weights[p.y][i];
+        s.col[i] = k.weights[i][p.x];
+    }
+    s.divisor = pivot == W(0) ? k.divisor : pivot * k.divisor;
+    return s;
+}
+
+// What a generic stencil function gets passed for each cell.
+// Reads outside the grid follow the border policy.
+template<typename T, int2d_t Radius>
+class stencil_window_t
+{
+public:
+    static constexpr int2d_t radius = Radius;
+
+    stencil_window_t(T const* const* rows, coord_t pos)
+    : m_rows(rows)
+    , m_pos(pos)
+    {}
+
+    // 'dx' and 'dy' are in the range [-radius, radius].
+    T const& operator()(int2d_t dx, int2d_t dy) const
+    {
+        assert(std::abs(dx) <= Radius && std::abs(dy) <= Radius);
+        return m_rows[dy + Radius][m_pos.x + Radius + dx];
+    }
+
+    T const& operator[](coord_t offset) const
+    {
+        return operator()(offset.x, offset.y);
+    }
+
+    T const& center() const { return operator()(0, 0); }
+
+    // The coordinate in the grid of the cell being computed.
+    coord_t position() const { return m_pos; }
+private:
+    T const* const* m_rows;
+    coord_t m_pos;
+};
+
+namespace impl
+{
+    inline int2d_t clamp_index(int2d_t i, int2d_t n)
+    {
+        return std::min(std::max(i, 0), n - 1);
+    }
+
+    inline int2d_t wrap_index(int2d_t i, int2d_t n)
+    {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    // Copies row 'y' of 'src' into 'out', extended by 'r' cells on both
+    // sides. 'out' holds 'dim.w + 2*r' cells.
+    template<typename T>
+    void pad_row(T const* src, dimen_t dim, int2d_t y, int2d_t r,
+                 border_clamp, T* out)
+    {
+        T const* row = src + clamp_index(y, dim.h) * dim.w;
+        std::fill(out, out + r, row[0]);
+        std::copy(row, row + dim.w, out + r);
+        std::fill(out + r + dim.w, out + 2*r + dim.w, row[dim.w - 1]);
+    }
+
+    template<typename T>
+    void pad_row(T const* src, dimen_t dim, int2d_t y, int2d_t r,
+                 border_skip, T* out)
+    {
+        // Padding is never read from, so clamping is as good as anything.
+        pad_row(src, dim, y, r, border_clamp{}, out);
+    }
+
+    template<typename T>
+    void pad_row(T const* src, dimen_t dim, int2d_t y, int2d_t r,
+                 border_wrap, T* out)
+    {
+        T const* row = src + wrap_index(y, dim.h) * dim.w;
+        for(int2d_t i = 0; i < r; ++i)
+        {
+            out[i] = row[wrap_index(i - r, dim.w)];
+            out[r + dim.w + i] = row[wrap_index(dim.w + i, dim.w)];
+        }
+        std::copy(row, row + dim.w, out + r);
+    }
+
+    template<typename T, typename U>
+    void pad_row(T const* src, dimen_t dim, int2d_t y, int2d_t r,
+                 border_constant<U> const& border, T* out)
+    {
+        T const value = static_cast<T>(border.value);
+        if(y < 0 || y >= dim.h)
+        {
+            std::fill(out, out + 2*r + dim.w, value);
+            return;
+        }
+        T const* row = src + y * dim.w;
+        std::fill(out, out + r, value);
+        std::copy(row, row + dim.w, out + r);
+        std::fill(out + r + dim.w, out + 2*r + dim.w, value);
+    }
+
+    // The range of cells that get written to.
+    template<typename Border>
+    rect_t stencil_output_rect(dimen_t dim, int2d_t, Border)
+    {
+        return to_rect(dim);
+    }
+
+    inline rect_t stencil_output_rect(dimen_t dim, int2d_t r, border_skip)
+    {
+        if(dim.w <= 2*r || dim.h <= 2*r)
+            return {};
+        return rect_margin(to_rect(dim), r);
+    }
+
+    // Calls 'make_row(y, out)' once for each row in [y0 - R, y1 + R)
+    // and 'use_rows(y, rows)' for each row in [y0, y1), where 'rows'
+    // points to the rows made for [y - R, y + R].
+    template<int2d_t R, typename Row, typename MakeRow, typename UseRows>
+    void slide_rows(int2d_t y0, int2d_t y1, std::size_t row_length,
+                    MakeRow make_row, UseRows use_rows)
+    {
+        constexpr int2d_t size = 2 * R + 1;
+        std::vector<Row> ring(size * row_length);
+        std::array<Row const*, size> rows;
+        auto const slot = [&](int2d_t y)
+        {
+            return ring.data() + wrap_index(y, size) * row_length;
+        };
+
+        for(int2d_t y = y0 - R; y < y0 + R; ++y)
+            make_row(y, slot(y));
+        for(int2d_t y = y0; y < y1; ++y)
+        {
+            make_row(y + R, slot(y + R));
+            for(int2d_t i = 0; i < size; ++i)
+                rows[i] = slot(y - R + i);
+            use_rows(y, rows.data());
+        }
+    }
+
+    template<typename D, typename Acc>
+    void store_row(D* out, Acc const* acc, int2d_t x0, int2d_t x1,
+                   Acc divisor)
+    {
+        if(divisor == Acc(1))
+            for(int2d_t x = x0; x < x1; ++x)
+                out[x] = static_cast<D>(acc[x]);
+        else
+            for(int2d_t x = x0; x < x1; ++x)
+                out[x] = static_cast<D>(acc[x] / divisor);
+    }
+
+    template<typename Acc, typename T, typename W>
+    using stencil_acc_t = typename std::conditional<
+        std::is_void<Acc>::value,
+        decltype(std::declval<W>() * std::declval<T>()),
+        Acc>::type;
+} // namespace impl
+
+// Sets each cell of 'dest' to the weighted sum of the neighborhood
+// of the matching cell in 'src'. 'src' and 'dest' must have the same
+// dimensions and must not be the same grid.
+// 'Acc' is the type sums are accumulated in.
+// Separable kernels are automatically split into two passes.
+template<typename Acc = void, typename Src, typename Dest,
+         typename W, int2d_t R, typename Border = border_clamp>
+void convolve(Src const& src, Dest& dest,
+              stencil_kernel_t<W, R> const& kernel,
+              Border border = Border(),
+              parallel_opts_t opts = {})
+{
+    static_assert(is_grid<Src>::value, "must be a Grid");
+    static_assert(is_grid<Dest>::value, "must be a Grid");
+    using T = typename Src::value_type;
+    using D = typename Dest::value_type;
+    using A = impl::stencil_acc_t<Acc, T, W>;
+    constexpr int2d_t size = 2 * R + 1;
+
+    dimen_t const dim = src.dimen();
+    assert(dest.dimen() == dim);
+    assert(static_cast<void const*>(src.data())
+           != static_cast<void const*>(dest.data()));
+    rect_t const out = impl::stencil_output_rect(dim, R, border);
+    if(!out)
+        return;
+
+    T const* const src_data = src.data();
+    D* const dest_data = dest.data();
+    std::size_t const padded_w = dim.w + 2*R;
+
+    if(is_separable(kernel))
+    {
+        separable_kernel_t<W, R> const s = separate(kernel);
+        parallel_bands(out.c.y, out.ey(), [&](int2d_t b0, int2d_t b1)
+        {
+            std::vector<T> padded(padded_w);
+            std::vector<A> acc(dim.w);
+            auto const make_row = [&](int2d_t y, A* hrow)
+            {
+                impl::pad_row(src_data, dim, y, R, border, padded.data());
+                std::fill(hrow, hrow + dim.w, A(0));
+                for(int2d_t i = 0; i < size; ++i)
+                {
+                    A const w = static_cast<A>(s.row[i]);
+                    if(w == A(0))
+                        continue;
+                    T const* p = padded.data() + i;
+                    for(int2d_t x = 0; x < dim.w; ++x)
+                        hrow[x] += w * static_cast<A>(p[x]);
+                }
+            };
+            auto const use_rows = [&](int2d_t y, A const* const* rows)
+            {
+                std::fill(acc.begin(), acc.end(), A(0));
+                for(int2d_t i = 0; i < size; ++i)
+                {
+                    A const w = static_cast<A>(s.col[i]);
+                    if(w == A(0))
+                        continue;
+                    A const* p = rows[i];
+                    for(int2d_t x = out.c.x; x < out.ex(); ++x)
+                        acc[x] += w * p[x];
+                }
+                impl::store_row(dest_data + y * dim.w, acc.data(),
+                                out.c.x, out.ex(), static_cast<A>(s.divisor));
+            };
+            impl::slide_rows<R, A>(b0, b1, dim.w, make_row, use_rows);
+        }, opts);
+    }
+    else
+    {
+        parallel_bands(out.c.y, out.ey(), [&](int2d_t b0, int2d_t b1)
+        {
+            std::vector<A> acc(dim.w);
+            auto const make_row = [&](int2d_t y, T* row)
+            {
+                impl::pad_row(src_data, dim, y, R, border, row);
+            };
+            auto const use_rows = [&](int2d_t y, T const* const* rows)
+            {
+                std::fill(acc.begin(), acc.end(), A(0));
+                for(int2d_t i = 0; i < size; ++i)
+                for(int2d_t j = 0; j < size; ++j)
+                {
+                    A const w = static_cast<A>(kernel.weights[i][j]);
+                    if(w == A(0))
+                        continue;
+                    T const* p = rows[i] + j;
+                    for(int2d_t x = out.c.x; x < out.ex(); ++x)
+                        acc[x] += w * static_cast<A>(p[x]);
+                }
+                impl::store_row(dest_data + y * dim.w, acc.data(),
+                                out.c.x, out.ex(),
+                                static_cast<A>(kernel.divisor));
+            };
+            impl::slide_rows<R, T>(b0, b1, padded_w, make_row, use_rows);
+        }, opts);
+    }
+}
+
+// Sets each cell of 'dest' to 'func(window)', where 'window' is a
+// 'stencil_window_t<T, Radius>' centered on the matching cell of 'src'.
+// 'src' and 'dest' must have the same dimensions and must not be the
+// same grid. 'func' may be called from several threads at once.
+template<int2d_t Radius, typename Src, typename Dest, typename Func,
+         typename Border = border_clamp>
+void apply_stencil(Src const& src, Dest& dest, Func func,
+                   Border border = Border(),
+                   parallel_opts_t opts = {})
+{
+    static_assert(is_grid<Src>::value, "must be a Grid");
+    static_assert(is_grid<Dest>::value, "must be a Grid");
+    using T = typename Src::value_type;
+    using D = typename Dest::value_type;
+
+    dimen_t const dim = src.dimen();
+    assert(dest.dimen() == dim);
+    assert(static_cast<void const*>(src.data())
+           != static_cast<void const*>(dest.data()));
+    rect_t const out = impl::stencil_output_rect(dim, Radius, border);
+    if(!out)
+        return;
+
+    T const* const src_data = src.data();
+    D* const dest_data = dest.data();
+
+    parallel_bands(out.c.y, out.ey(), [&](int2d_t b0, int2d_t b1)
+    {
+        auto const make_row = [&](int2d_t y, T* row)
+        {
+            impl::pad_row(src_data, dim, y, Radius, border, row);
+        };
+        auto const use_rows = [&](int2d_t y, T const* const* rows)
+        {
+            D* const dest_row = dest_data + y * dim.w;
+            for(int2d_t x = out.c.x; x < out.ex(); ++x)
+            {
+                stencil_window_t<T, Radius> const window(rows, { x, y });
+                dest_row[x] = static_cast<D>(func(window));
+            }
+        };
+        impl::slide_rows<Radius, T>(b0, b1, dim.w + 2*Radius,
+                                    make_row, use_rows);
+    }, opts);
+}
+
+} // namespace i2d
+
+#endif
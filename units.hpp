@@ -44,255 +44,361 @@ T mapc(T t, Func func)
     return ret;
 }
 
-struct dimen_t
-{
+// The units below are templates on their scalar type 'S', which should be
+// a signed integer. 'coord_t', 'dimen_t' and 'rect_t' use 'int2d_t', and
+// the 16 and 64 bit variants trade range for size.
+// Arithmetic is done in at least 'int' and converted back to 'S'.
+// Functions on the units default 'S' to 'int2d_t' so that calls with
+// only braced arguments, like 'to_rect({ 3, 4 })', still work.
+
+// A scalar parameter that doesn't take part in deduction, so that
+// 'f(crd, 1)' works for any 'basic_coord_t<S>'.
+template<typename S>
+using scalar_arg_t = typename std::common_type<S>::type;
+
+// What arithmetic on 'S' produces: 'int' for types smaller than it.
+template<typename S>
+using promoted_t = decltype(S() + S());
+
+template<typename S>
+struct basic_dimen_t
+{
+    using value_type = S;
     static constexpr std::size_t components = 2;
 
-    int2d_t w;
-    int2d_t h;
+    S w;
+    S h;
 
-    int2d_t const& operator[](component_index<0>) const { return w; }
-    int2d_t& operator[](component_index<0>) { return w; }
-    int2d_t const& operator[](component_index<1>) const { return h; }
-    int2d_t& operator[](component_index<1>) { return h; }
+    S const& operator[](component_index<0>) const { return w; }
+    S& operator[](component_index<0>) { return w; }
+    S const& operator[](component_index<1>) const { return h; }
+    S& operator[](component_index<1>) { return h; }
 
     constexpr explicit operator bool() const { return w | h; }
 };
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr bool operator==(dimen_t lhs, dimen_t rhs)
+constexpr bool operator==(basic_dimen_t<S> lhs, basic_dimen_t<S> rhs)
 {
     return lhs.w == rhs.w && lhs.h == rhs.h;
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr bool operator!=(dimen_t lhs, dimen_t rhs)
+constexpr bool operator!=(basic_dimen_t<S> lhs, basic_dimen_t<S> rhs)
 {
     return !(lhs == rhs);
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr bool operator<(dimen_t lhs, dimen_t rhs)
+constexpr bool operator<(basic_dimen_t<S> lhs, basic_dimen_t<S> rhs)
 {
     return lhs.w != rhs.w ? lhs.w < rhs.w : lhs.h < rhs.h;
 }
 
-constexpr dimen_t operator+(dimen_t lhs, dimen_t rhs)
+template<typename S>
+constexpr basic_dimen_t<S> operator+(basic_dimen_t<S> lhs,
+                                     basic_dimen_t<S> rhs)
 {
-    return { lhs.w + rhs.w, lhs.h + rhs.h };
+    return { S(lhs.w + rhs.w), S(lhs.h + rhs.h) };
 }
 
-constexpr dimen_t operator-(dimen_t lhs, dimen_t rhs)
+template<typename S>
+constexpr basic_dimen_t<S> operator-(basic_dimen_t<S> lhs,
+                                     basic_dimen_t<S> rhs)
 {
-    return { lhs.w - rhs.w, lhs.h - rhs.h };
+    return { S(lhs.w - rhs.w), S(lhs.h - rhs.h) };
 }
 
-inline dimen_t& operator+=(dimen_t& lhs, dimen_t rhs)
+template<typename S>
+inline basic_dimen_t<S>& operator+=(basic_dimen_t<S>& lhs,
+                                    basic_dimen_t<S> rhs)
 {
     lhs = lhs + rhs;
     return lhs;
 }
 
-inline dimen_t& operator-=(dimen_t& lhs, dimen_t rhs)
+template<typename S>
+inline basic_dimen_t<S>& operator-=(basic_dimen_t<S>& lhs,
+                                    basic_dimen_t<S> rhs)
 {
     lhs = lhs - rhs;
     return lhs;
 }
 
-constexpr dimen_t operator+(dimen_t lhs)
+template<typename S>
+constexpr basic_dimen_t<S> operator+(basic_dimen_t<S> lhs)
 {
     return lhs;
 }
 
-constexpr dimen_t operator-(dimen_t lhs)
+template<typename S>
+constexpr basic_dimen_t<S> operator-(basic_dimen_t<S> lhs)
 {
-    return { -lhs.w, -lhs.h };
+    return { S(-lhs.w), S(-lhs.h) };
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr dimen_t operator*(dimen_t lhs, int2d_t scale)
+constexpr basic_dimen_t<S> operator*(basic_dimen_t<S> lhs,
+                                     scalar_arg_t<S> scale)
 {
-    return { lhs.w * scale, lhs.h * scale };
+    return { S(lhs.w * scale), S(lhs.h * scale) };
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr dimen_t operator/(dimen_t lhs, int2d_t scale)
+constexpr basic_dimen_t<S> operator/(basic_dimen_t<S> lhs,
+                                     scalar_arg_t<S> scale)
 {
-    return { lhs.w / scale, lhs.h / scale };
+    return { S(lhs.w / scale), S(lhs.h / scale) };
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr dimen_t vec_mul(dimen_t dim, int2d_t v)
+constexpr basic_dimen_t<S> vec_mul(basic_dimen_t<S> dim,
+                                   scalar_arg_t<S> v)
 {
     return dim * v;
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr dimen_t vec_div(dimen_t dim, int2d_t v)
+constexpr basic_dimen_t<S> vec_div(basic_dimen_t<S> dim,
+                                   scalar_arg_t<S> v)
 {
-    return { dim.w / v, dim.h / v };
+    return { S(dim.w / v), S(dim.h / v) };
 }
 
+template<typename S>
 [[gnu::always_inline]]
-constexpr dimen_t dimen_t_add(dimen_t d1, dimen_t d2)
+constexpr basic_dimen_t<S> dimen_t_add(basic_dimen_t<S> d1,
+                                       basic_dimen_t<S> d2)
 {
-    return { d1.w + d2.h, d1.h + d2.h };
+    return { S(d1.w + d2.h), S(d1.h + d2.h) };
 }
 
-struct coord_t
+template<typename S>
+struct basic_coord_t
 {
+    using value_type = S;
     static constexpr std::size_t components = 2;
 
-    int2d_t x;
-    int2d_t y;
+    S x;
+    S y;
 
-    int2d_t const& operator[](component_index<0>) const { return x; }
-    int2d_t& operator[](component_index<0>) { return x; }
-    int2d_t const& operator[](component_index<1>) const { return y; }
-    int2d_t& operator[](component_index<1>) { return y; }
+    S const& operator[](component_index<0>) const { return x; }
+    S& operator[](component_index<0>) { return x; }
+    S const& operator[](component_index<1>) const { return y; }
+    S& operator[](component_index<1>) { return y; }
 
     constexpr explicit operator bool() const { return x | y; }
 };
 
-constexpr bool operator==(coord_t lhs, coord_t rhs)
+template<typename S>
+constexpr bool operator==(basic_coord_t<S> lhs, basic_coord_t<S> rhs)
 {
     return lhs.x == rhs.x && lhs.y == rhs.y;
 }
 
-constexpr bool operator!=(coord_t lhs, coord_t rhs)
+template<typename S>
+constexpr bool operator!=(basic_coord_t<S> lhs, basic_coord_t<S> rhs)
 {
     return !(lhs == rhs);
 }
 
-constexpr bool operator<(coord_t lhs, coord_t rhs)
+template<typename S>
+constexpr bool operator<(basic_coord_t<S> lhs, basic_coord_t<S> rhs)
 {
     return lhs.x != rhs.x ? lhs.x < rhs.x : lhs.y < rhs.y;
 }
 
-constexpr coord_t operator+(coord_t lhs, coord_t rhs)
+template<typename S>
+constexpr basic_coord_t<S> operator+(basic_coord_t<S> lhs,
+                                     basic_coord_t<S> rhs)
 {
-    return { lhs.x + rhs.x, lhs.y + rhs.y };
+    return { S(lhs.x + rhs.x), S(lhs.y + rhs.y) };
 }
 
-constexpr coord_t operator-(coord_t lhs, coord_t rhs)
+template<typename S>
+constexpr basic_coord_t<S> operator-(basic_coord_t<S> lhs,
+                                     basic_coord_t<S> rhs)
 {
-    return { lhs.x - rhs.x, lhs.y - rhs.y };
+    return { S(lhs.x - rhs.x), S(lhs.y - rhs.y) };
 }
 
-constexpr coord_t& operator+=(coord_t& lhs, coord_t rhs)
+template<typename S>
+constexpr basic_coord_t<S>& operator+=(basic_coord_t<S>& lhs,
+                                       basic_coord_t<S> rhs)
 {
     lhs = lhs + rhs;
     return lhs;
 }
 
-constexpr coord_t& operator-=(coord_t& lhs, coord_t rhs)
+template<typename S>
+constexpr basic_coord_t<S>& operator-=(basic_coord_t<S>& lhs,
+                                       basic_coord_t<S> rhs)
 {
     lhs = lhs - rhs;
     return lhs;
 }
 
-constexpr coord_t operator+(coord_t lhs)
+template<typename S>
+constexpr basic_coord_t<S> operator+(basic_coord_t<S> lhs)
 {
     return lhs;
 }
 
-constexpr coord_t operator-(coord_t lhs)
+template<typename S>
+constexpr basic_coord_t<S> operator-(basic_coord_t<S> lhs)
 {
-    return { -lhs.x, -lhs.y };
+    return { S(-lhs.x), S(-lhs.y) };
 }
 
-constexpr coord_t vec_mul(coord_t crd, int2d_t v)
+template<typename S>
+constexpr basic_coord_t<S> vec_mul(basic_coord_t<S> crd,
+                                   scalar_arg_t<S> v)
 {
-    return { crd.x * v, crd.y * v };
+    return { S(crd.x * v), S(crd.y * v) };
 }
 
-constexpr coord_t vec_div(coord_t crd, int2d_t v)
+template<typename S>
+constexpr basic_coord_t<S> vec_div(basic_coord_t<S> crd,
+                                   scalar_arg_t<S> v)
 {
-    return { crd.x / v, crd.y / v };
+    return { S(crd.x / v), S(crd.y / v) };
 }
 
-struct rect_t
+template<typename S>
+struct basic_rect_t
 {
-    coord_t c;
-    dimen_t d;
+    using value_type = S;
+    using coord_type = basic_coord_t<S>;
+    using dimen_type = basic_dimen_t<S>;
+
+    coord_type c;
+    dimen_type d;
 
     constexpr explicit operator bool() const { return (bool)d; }
 
     // 'end'
-    coord_t e() const { return { ex(), ey() }; }
+    coord_type e() const { return { ex(), ey() }; }
     template<typename C>
-    int2d_t e(C c) const { return e()[c]; }
-    constexpr int2d_t ex() const { return c.x + d.w; }
-    constexpr int2d_t ey() const { return c.y + d.h; }
+    S e(C c) const { return e()[c]; }
+    constexpr S ex() const { return S(c.x + d.w); }
+    constexpr S ey() const { return S(c.y + d.h); }
 
     // 'rbegin'
-    coord_t r() const { return { rx(), ry() }; }
+    coord_type r() const { return { rx(), ry() }; }
     template<typename C>
-    int2d_t r(C c) const { return r()[c]; }
-    constexpr int2d_t rx() const { return c.x + d.w - 1; }
-    constexpr int2d_t ry() const { return c.y + d.h - 1; }
+    S r(C c) const { return r()[c]; }
+    constexpr S rx() const { return S(c.x + d.w - 1); }
+    constexpr S ry() const { return S(c.y + d.h - 1); }
 
-    coord_t xy() const { return c; }
+    coord_type xy() const { return c; }
 
-    coord_t exy() const { return { ex(), c.y }; }
-    coord_t xey() const { return { c.x, ey() }; }
-    coord_t exey() const { return { ex(), ey() }; }
+    coord_type exy() const { return { ex(), c.y }; }
+    coord_type xey() const { return { c.x, ey() }; }
+    coord_type exey() const { return { ex(), ey() }; }
 
-    coord_t rxy() const { return { rx(), c.y }; }
-    coord_t xry() const { return { c.x, ry() }; }
-    coord_t rxry() const { return { rx(), ry() }; }
+    coord_type rxy() const { return { rx(), c.y }; }
+    coord_type xry() const { return { c.x, ry() }; }
+    coord_type rxry() const { return { rx(), ry() }; }
 
-    coord_t nw() const { return c; }
-    coord_t ne() const { return rxy(); }
-    coord_t sw() const { return xry(); }
-    coord_t se() const { return rxry(); }
+    coord_type nw() const { return c; }
+    coord_type ne() const { return rxy(); }
+    coord_type sw() const { return xry(); }
+    coord_type se() const { return rxry(); }
 };
 
-constexpr bool operator==(rect_t lhs, rect_t rhs)
+template<typename S>
+constexpr bool operator==(basic_rect_t<S> lhs, basic_rect_t<S> rhs)
 {
     return lhs.c == rhs.c && lhs.d == rhs.d;
 }
 
-constexpr bool operator!=(rect_t lhs, rect_t rhs)
+template<typename S>
+constexpr bool operator!=(basic_rect_t<S> lhs, basic_rect_t<S> rhs)
 {
     return !(lhs == rhs);
 }
 
-constexpr bool operator<(rect_t lhs, rect_t rhs)
+template<typename S>
+constexpr bool operator<(basic_rect_t<S> lhs, basic_rect_t<S> rhs)
 {
     return lhs.c != rhs.c ? lhs.c < rhs.c : lhs.d < rhs.d;
 }
 
-constexpr rect_t operator+(rect_t lhs, coord_t rhs)
+template<typename S>
+constexpr basic_rect_t<S> operator+(basic_rect_t<S> lhs, basic_coord_t<S> rhs)
 {
     lhs.c += rhs;
     return lhs;
 }
 
-constexpr rect_t operator+(coord_t lhs, rect_t rhs)
+template<typename S>
+constexpr basic_rect_t<S> operator+(basic_coord_t<S> lhs, basic_rect_t<S> rhs)
 {
     rhs.c += lhs;
     return rhs;
 }
 
-constexpr rect_t operator-(rect_t lhs, coord_t rhs)
+template<typename S>
+constexpr basic_rect_t<S> operator-(basic_rect_t<S> lhs, basic_coord_t<S> rhs)
 {
     lhs.c -= rhs;
     return lhs;
 }
 
-constexpr rect_t& operator+=(rect_t& lhs, coord_t rhs)
+template<typename S>
+constexpr basic_rect_t<S>& operator+=(basic_rect_t<S>& lhs,
+                                      basic_coord_t<S> rhs)
 {
     lhs = lhs + rhs;
     return lhs;
 }
 
-constexpr rect_t& operator-=(rect_t& lhs, coord_t rhs)
+template<typename S>
+constexpr basic_rect_t<S>& operator-=(basic_rect_t<S>& lhs,
+                                      basic_coord_t<S> rhs)
 {
     lhs = lhs - rhs;
     return lhs;
 }
 
+using dimen_t = basic_dimen_t<int2d_t>;
+using coord_t = basic_coord_t<int2d_t>;
+using rect_t = basic_rect_t<int2d_t>;
+
+using dimen16_t = basic_dimen_t<std::int16_t>;
+using coord16_t = basic_coord_t<std::int16_t>;
+using rect16_t = basic_rect_t<std::int16_t>;
+
+using dimen64_t = basic_dimen_t<std::int64_t>;
+using coord64_t = basic_coord_t<std::int64_t>;
+using rect64_t = basic_rect_t<std::int64_t>;
+
+// Conversions between scalar types. Values must fit in 'To'.
+
+template<typename To, typename From>
+constexpr basic_dimen_t<To> dimen_cast(basic_dimen_t<From> dim)
+{
+    return { static_cast<To>(dim.w), static_cast<To>(dim.h) };
+}
+
+template<typename To, typename From>
+constexpr basic_coord_t<To> coord_cast(basic_coord_t<From> crd)
+{
+    return { static_cast<To>(crd.x), static_cast<To>(crd.y) };
+}
+
+template<typename To, typename From>
+constexpr basic_rect_t<To> rect_cast(basic_rect_t<From> r)
+{
+    return { coord_cast<To>(r.c), dimen_cast<To>(r.d) };
+}
 
 template<typename X, typename Y>
 constexpr coord_t make_coord(X x, Y y)